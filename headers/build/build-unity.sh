@@ -0,0 +1,58 @@
+#!/bin/sh
+
+# This script compiles all files with .cpp extension in the parent directory as
+# a unity build: several programs per translation unit, each wrapped in its own
+# namespace, linked into the single multi-call binary "examples" (run either as
+# "./examples <program> [arguments]" or through a link named after a program).
+# Build time and binary size are compared with building the programs separately.
+# Environment variables CXX (default g++) and PER_FILE (default 12) may be set.
+
+if [ -z "$CXX" ] ; then
+  CXX="g++"
+fi
+if [ -z "$PER_FILE" ] ; then
+  PER_FILE=12
+fi
+FLAGS="-std=c++23"
+JOBS="$(nproc 2>/dev/null || echo 1)"
+export CXX FLAGS
+
+elapsed() {
+  echo "$1 $(date +%s.%N)" | awk '{ printf "%.2f", $2 - $1 }'
+}
+
+# Only programs which compile on their own are included in either build
+echo "Finding programs which compile..."
+make -j"$JOBS" CXX="$CXX" CXXFLAGS="$FLAGS" >/dev/null
+sources=""
+targets=""
+for log in logs/*.log ; do
+  if [ "$(tail -n 1 "$log")" != "FAILED" ] ; then
+    sources="$sources ../$(basename "${log%.log}").cpp"
+    targets="$targets $log"
+  fi
+done
+
+echo "Separate build..."
+make clean >/dev/null
+start=$(date +%s.%N)
+make -j"$JOBS" CXX="$CXX" CXXFLAGS="$FLAGS" $targets >/dev/null
+separate_time=$(elapsed $start)
+separate_size=0
+for log in $targets ; do
+  separate_size=$((separate_size + $(wc -c <"$(basename "${log%.log}")")))
+done
+
+echo "Unity build..."
+rm -rf unity examples
+mkdir unity
+"$CXX" -std=c++23 -O2 -o unity/make-unity ../../scripts/make-unity.cpp || exit 1
+start=$(date +%s.%N)
+unity_files=$(./unity/make-unity unity "$PER_FILE" $sources)
+echo "$unity_files" | xargs -P "$JOBS" -I {} sh -c '"$CXX" $FLAGS -c {} -o $(dirname {})/$(basename {} .cpp).o' || exit 1
+"$CXX" -o examples unity/*.o || exit 1
+unity_time=$(elapsed $start)
+unity_size=$(wc -c <examples)
+
+echo "Separate build: $(echo $targets | wc -w) programs, ${separate_time}s, $separate_size bytes"
+echo "Unity build: $(grep -c '^    { "' unity/unity-main.cpp) programs in $(echo "$unity_files" | wc -l) files, ${unity_time}s, $unity_size bytes"
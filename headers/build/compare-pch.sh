@@ -0,0 +1,25 @@
+#!/bin/sh
+
+# This script times a clean build of all the programs in the parent directory
+# with and without the precompiled prelude.h, using the Makefile in this directory
+# Usage: compare-pch.sh [make options, such as CXX=clang++]
+
+JOBS="$(nproc 2>/dev/null || echo 1)"
+
+build() {
+  make clean >/dev/null
+  start=$(date +%s.%N)
+  make -j"$JOBS" "$@" | tail -n 1
+  end=$(date +%s.%N)
+  echo "$start $end" | awk '{ printf "%.2f\n", $2 - $1 }'
+}
+
+echo "Plain build..."
+plain=$(build "$@" | tee /dev/stderr | tail -n 1)
+echo "Precompiled header build..."
+pch=$(build PCH=1 "$@" | tee /dev/stderr | tail -n 1)
+make clean >/dev/null
+
+echo "Plain build: ${plain}s"
+echo "With PCH: ${pch}s"
+echo "$plain $pch" | awk '{ printf "Saving: %.2fs (%.1f%%)\n", $1 - $2, 100 * ($1 - $2) / $1 }'
@@ -0,0 +1,14 @@
+// prelude.h : standard headers used by most of the programs, precompiled by "make PCH=1"
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#if __has_include(<format>)
+#include <format>
+#endif
+#if __has_include(<print>)
+#include <print>
+#endif
@@ -7,12 +7,17 @@ if [ -z "$CLANG_PREFIX" ] ; then
   CLANG_PREFIX="/usr"
 fi
 
+CLANG="$CLANG_PREFIX/bin/clang++"
+FLAGS="-std=c++23 -stdlib=libc++"
+JOBS="$(nproc 2>/dev/null || echo 1)"
+
+# The std module is cached per compiler version and flags, so that a compiler
+# upgrade never reuses a stale module
 if [ -z "$CLANG_PCM" ] ; then
-   CLANG_PCM="./std.pcm"
+  KEY="$( { "$CLANG" --version ; echo "$FLAGS" ; } | cksum | cut -d ' ' -f 1)"
+  CLANG_PCM="./cache/clang++-$KEY/std.pcm"
 fi
 
-CLANG="$CLANG_PREFIX/bin/clang++"
-
 if [ ! -f "$CLANG_PCM" ] ; then
   echo "Compiling library module..."
   if [ ! -f "$CLANG_PREFIX/share/libc++/v1/std.cppm" ] ; then
@@ -20,21 +25,17 @@ if [ ! -f "$CLANG_PCM" ] ; then
     echo "Please set environment variable CLANG_PREFIX and re-run script"
     exit 1
   fi
+  mkdir -p "$(dirname "$CLANG_PCM")"
     LD_LIBRARY_PATH="$CLANG_PREFIX/lib":"$CLANG_PREFIX/lib/x86_64-unknown-linux-gnu" \
-      "$CLANG" -std=c++23 -stdlib=libc++ -Wno-reserved-identifier -Wno-reserved-module-identifier \
+      "$CLANG" $FLAGS -Wno-reserved-identifier -Wno-reserved-module-identifier \
       --precompile -o "$CLANG_PCM" "$CLANG_PREFIX/share/libc++/v1/std.cppm"
 fi
 
-failures=0
-for PROGRAM in ../*.cpp ; do
-  BASE="$(basename $PROGRAM)"
-  echo "$BASE..."
-  failed=""
+export CLANG CLANG_PREFIX CLANG_PCM FLAGS
+failures=$(ls ../*.cpp | xargs -P "$JOBS" -I {} sh -c '
+  BASE="$(basename {})"
+  echo "$BASE..." >&2
   LD_LIBRARY_PATH="$CLANG_PREFIX/lib":"$CLANG_PREFIX/lib/x86_64-unknown-linux-gnu" \
-    "$CLANG" -fmodule-file=std="$CLANG_PCM" -std=c++23 -stdlib=libc++ -o ${BASE%.cpp} $PROGRAM || failed="y"
-  if [ -n "$failed" ] ; then
-    echo "Failed to compile $BASE"
-    failures=$((failures+1))
-  fi
-done
+    "$CLANG" -fmodule-file=std="$CLANG_PCM" $FLAGS -o ${BASE%.cpp} {} || echo "Failed to compile $BASE"
+' | tee /dev/stderr | grep -c "^Failed to compile")
 echo "A total of $failures files failed to compile."
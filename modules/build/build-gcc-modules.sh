@@ -0,0 +1,32 @@
+#!/bin/sh
+
+# This script will compile all files with .cpp extension in the parent directory
+# GCC version 15 (or newer) C++ modules version
+
+if [ -z "$GCC" ] ; then
+  GCC="g++"
+fi
+
+FLAGS="-std=c++23"
+JOBS="$(nproc 2>/dev/null || echo 1)"
+
+# The std module is cached per compiler version and flags, so that a compiler
+# upgrade never reuses a stale module
+KEY="$( { "$GCC" --version ; echo "$FLAGS" ; } | cksum | cut -d ' ' -f 1)"
+CACHE="$PWD/cache/g++-$KEY"
+
+if [ ! -f "$CACHE/std.gcm" ] ; then
+  echo "Compiling library module..."
+  mkdir -p "$CACHE"
+  echo "std $CACHE/std.gcm" >"$CACHE/mapper"
+  "$GCC" $FLAGS -fmodules -fmodule-mapper="$CACHE/mapper" -fsearch-include-path \
+    -c bits/std.cc -o "$CACHE/std.o" || exit 1
+fi
+
+export GCC FLAGS CACHE
+failures=$(ls ../*.cpp | xargs -P "$JOBS" -I {} sh -c '
+  BASE="$(basename {})"
+  echo "$BASE..." >&2
+  "$GCC" -fmodules -fmodule-mapper="$CACHE/mapper" $FLAGS -o ${BASE%.cpp} {} "$CACHE/std.o" || echo "Failed to compile $BASE"
+' | tee /dev/stderr | grep -c "^Failed to compile")
+echo "A total of $failures files failed to compile."
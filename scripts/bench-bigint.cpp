@@ -0,0 +1,61 @@
+// bench-bigint.cpp : time bigint.h's powers and factorials, with and without Karatsuba multiplication
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include "bigint.h"
+using namespace std;
+
+double best_of(size_t runs, const function<void()>& f) {
+    double best{ 1.0e30 };
+    for (size_t i = 0; i != runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    unsigned long long exponent{ 100000 }, n{ 50000 };
+    size_t runs{ 3 };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-e") {
+            exponent = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (option == "-f") {
+            n = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (option == "-n") {
+            runs = max(1, atoi(argv[i + 1]));
+        }
+    }
+    // A threshold larger than any operand turns Karatsuba multiplication off
+    auto threshold = big_integer::karatsuba_threshold;
+    big_integer power[2], product[2];
+    cout << fixed << setprecision(2) << "Times in ms, best of " << runs << " runs\n"
+        << setw(20) << "" << setw(12) << "schoolbook" << setw(12) << "Karatsuba\n";
+    double times[3][2];
+    for (int karatsuba : { 0, 1 }) {
+        big_integer::karatsuba_threshold = karatsuba ? threshold : SIZE_MAX;
+        times[0][karatsuba] = best_of(runs, [&] { power[karatsuba] = pow(big_integer{ 3 }, exponent); });
+        times[1][karatsuba] = best_of(runs, [&] { product[karatsuba] = factorial(n); });
+    }
+    big_integer::karatsuba_threshold = threshold;
+    string digits;
+    times[2][0] = times[2][1] = best_of(runs, [&] { digits = power[1].to_string(); });
+    string names[]{ "3 ^ " + to_string(exponent), to_string(n) + "!", "3 ^ " + to_string(exponent) + " in decimal" };
+    for (int i = 0; i != 3; ++i) {
+        cout << setw(20) << names[i] << setw(12) << times[i][0] * 1e3 << setw(11) << times[i][1] * 1e3 << '\n';
+    }
+    bool identical = (power[0] == power[1]) && (product[0] == product[1]);
+    cout << "3 ^ " << exponent << " has " << digits.size() << " digits, " << n << "! has " << product[1].bits()
+        << " bits; results " << (identical ? "identical" : "DIFFER") << '\n';
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+// bench-calc.cpp : time the iostream loop of 08-calc.cpp against calc-engine.h, checking their output is identical
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <tuple>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mapped-file.h"
+#include "calc-engine.h"
+#include "work-pool.h"
+using namespace std;
+
+// calc() and the loop in main() from 08-calc.cpp, with cout replaced by a parameter
+namespace original {
+
+double calc(char op, double x, double y) {
+    double r{};
+    switch (op) {
+    case '+':
+        r = x + y;
+        break;
+    case '-':
+        r = x - y;
+        break;
+    case '*':
+        r = x * y;
+        break;
+    case '/':
+        if (y) {
+            r = x / y;
+        }
+        else {
+            cerr << "Error: divide by zero.\n";
+        }
+        break;
+    case '^':
+        r = pow(x, y);
+        break;
+    default:
+        cerr << "Error: invalid op.\n";
+    }
+    return r;
+}
+
+void iostream_loop(const char *filename, ostream& out) {
+    ifstream infile{filename};
+
+    while (!infile.eof()) {
+        double x, y;
+        char op;
+        infile >> x >> op >> y;
+        if (infile.fail() || infile.bad()) {
+            cerr << "Error in input.\n";
+            break;
+        }
+        auto r = calc(op, x, y);
+        out << x << ' ' << op << ' ' << y << " = " << r << '\n';
+    }
+}
+
+} // namespace original
+
+void batch(const char *filename, int fd, string& messages, work_pool *pool) {
+    mapped_file input{ filename };
+    vector<calc::diagnostic> errors;
+    {
+        calc::output_buffer out{ fd };
+        if (pool) {
+            calc::run_parallel(input.view(), *pool, out, errors);
+        }
+        else {
+            calc::run_jobs(input.view(), true, out, errors);
+        }
+    }
+    for (const auto& error : errors) {
+        messages += calc::message(error.error);
+    }
+}
+
+// Both versions are run on the same file, with their standard output and
+// error compared; returns false (after showing the input) if they differ
+bool same_results(const string& input, const string& filename, work_pool& pool) {
+    {
+        ofstream file{ filename, ios_base::binary };
+        file << input;
+    }
+    ostringstream expected, expected_errors;
+    auto saved = cerr.rdbuf(expected_errors.rdbuf());
+    original::iostream_loop(filename.c_str(), expected);
+    cerr.rdbuf(saved);
+    // Tiny parts put jobs across part boundaries, for the parallel version
+    mapped_file mapped{ filename.c_str() };
+    for (size_t chunk_size : { size_t{}, size_t{ 1 }, size_t{ 7 } }) {
+        string errors;
+        calc::output_buffer out{ -1 };
+        vector<calc::diagnostic> diagnostics;
+        if (chunk_size == 0) {
+            calc::run_jobs(mapped.view(), true, out, diagnostics);
+        }
+        else {
+            calc::run_parallel(mapped.view(), pool, out, diagnostics, calc::output_format::cout, chunk_size);
+        }
+        for (const auto& d : diagnostics) {
+            errors += calc::message(d.error);
+        }
+        if ((out.view() != expected.str()) || (errors != expected_errors.str())) {
+            cerr << "Mismatch for input: \"" << input << "\" (part size " << chunk_size << ")\n  iostream: \""
+                << expected.str() << "\" \"" << expected_errors.str() << "\"\n  batch:    \"" << out.view()
+                << "\" \"" << errors << "\"\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+const vector<string> corner_cases{
+    "", "\n", "1 + 2", "1 + 2\n", "1 + 2\n\n", "  1+2  \r\n3*4", "+5 - +3\n", "+-5 - 3\n", "-0 * 1\n",
+    ".5 / .25\n", "5. ^ 2\n", "1e5 * 1e-5\n", "1E+3 - 2e-2\n", "1e * 2\n", "1e+ * 2\n", "1e400 + 1\n",
+    "1e-400 + 1\n", "inf + 1\n", "nan + 1\n", "0x10 + 1\n", "1 / 0\n", "1 % 2\n", "1 +\n 2\n", "1 2 3\n",
+    "1.5.3\n", "-8 ^ 0.5\n", "123456789 * 987654321\n", "1e-7 + 0\n", "0.0001 + 0\n", "2 ^ 1000\n",
+    "1 + 2\nx\n3 + 4\n", "7 - 3\t\v\f", "1\n+\n2\n3\n*\n\n4\n5 - 6\n", "1 + 2\n\n\n3 -\n\n4\n\n",
+    "1 / 0\n2 + 2\n3 / 0\n4 ? 4\n5 + 5 x\n6 + 6\n", "1e5e2 1\n", "4.9e-3241e 2\n", "2 * 1E2E3 4\n",
+    "1e5E+ 1\n", "3 + 1.5e\n",
+};
+
+// Integer and decimal operands, with occasional division by zero and
+// unknown operators so that the error paths are exercised
+void generate(const string& filename, size_t lines) {
+    mt19937 rng{ 42 };
+    uniform_int_distribution<int> number{ -100000, 100000 }, op{ 0, 99 }, form{ 0, 3 };
+    auto operand = [&] {
+        auto n = number(rng);
+        switch (form(rng)) {
+        case 0:
+            return to_string(n);
+        case 1:
+            return to_string(n / 100) + '.' + to_string(abs(n) % 100);
+        case 2:
+            return to_string(n) + "e-3";
+        default:
+            return to_string(n % 10);
+        }
+    };
+    ofstream out{ filename, ios_base::binary };
+    for (size_t i = 0; i != lines; ++i) {
+        auto o = op(rng);
+        out << operand() << ' ' << ((o == 0) ? '%' : "+-*/^"[o % 5]) << ' ' << operand() << '\n';
+    }
+}
+
+double best_of(size_t runs, const function<void()>& f);
+
+// Times evaluation alone, a switch per row against the masked kernel over
+// blocks of columns, and checks the results and errors are bitwise identical
+bool compare_kernels(size_t rows, size_t runs, string_view ops) {
+    mt19937 rng{ 7 };
+    uniform_real_distribution<double> number{ -1000, 1000 };
+    uniform_int_distribution<int> op{ 0, 99 }, small{ -4, 4 };
+    vector<calc::job> jobs(rows);
+    for (auto& j : jobs) {
+        auto o = op(rng);
+        j.op = (o == 0) ? '%' : ops[o % ops.size()];
+        j.x = number(rng);
+        j.y = (j.op == '^') ? small(rng) * 0.5 : ((o % 10) == 3) ? 0 : number(rng);
+    }
+    vector<double> expected(rows);
+    vector<calc::status> expected_errors(rows);
+    auto scalar_time = best_of(runs, [&] {
+        for (size_t i = 0; i != rows; ++i) {
+            expected[i] = calc::evaluate(jobs[i], expected_errors[i]);
+        }
+    });
+    vector<double> results(rows);
+    vector<calc::status> errors(rows);
+    calc::job_columns columns;
+    columns.resize(calc::block_size);
+    auto kernel_time = best_of(runs, [&] {
+        for (size_t first = 0; first < rows; first += calc::block_size) {
+            auto n = min(calc::block_size, rows - first);
+            columns.size = n;
+            for (size_t i = 0; i != n; ++i) {
+                columns.x[i] = jobs[first + i].x;
+                columns.y[i] = jobs[first + i].y;
+                columns.op[i] = jobs[first + i].op;
+            }
+            calc::evaluate_columns(columns);
+            copy_n(columns.r.begin(), n, results.begin() + first);
+            copy_n(columns.error.begin(), n, errors.begin() + first);
+        }
+    });
+    bool identical = (memcmp(results.data(), expected.data(), rows * sizeof(double)) == 0) && (errors == expected_errors);
+    cout << "Kernel, " << rows << " rows of " << ops << ": " << fixed << setprecision(1) << scalar_time * 1.0e9 / rows
+        << " ns/row with a switch per row, " << kernel_time * 1.0e9 / rows << " ns/row masked, "
+        << (identical ? "identical" : "DIFFERENT") << " results\n" << defaultfloat << setprecision(6);
+    return identical;
+}
+
+double best_of(size_t runs, const function<void()>& f) {
+    double best{ 1.0e30 };
+    for (size_t i = 0; i != runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    size_t lines{ 2000000 }, runs{ 3 };
+    unsigned threads{};
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-l") {
+            lines = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (option == "-n") {
+            runs = max(1, atoi(argv[i + 1]));
+        }
+        else if (option == "-j") {
+            threads = atoi(argv[i + 1]);
+        }
+    }
+    auto directory = filesystem::temp_directory_path();
+    auto prefix = (directory / ("bench-calc-" + to_string(getpid()))).string();
+    auto input = prefix + ".txt", expected = prefix + ".expected", output = prefix + ".out";
+
+    work_pool pool{ threads };
+    size_t failures{};
+    for (const auto& text : corner_cases) {
+        failures += !same_results(text, input, pool);
+    }
+    cout << corner_cases.size() - failures << " of " << corner_cases.size() << " corner cases identical\n";
+
+    failures += !compare_kernels(lines, runs, "+-*/^") + !compare_kernels(lines, runs, "+-*/");
+
+    generate(input, lines);
+    auto size = filesystem::file_size(input);
+    string expected_errors;
+    auto iostream_time = best_of(runs, [&] {
+        ofstream out{ expected, ios_base::binary };
+        ostringstream messages;
+        auto saved = cerr.rdbuf(messages.rdbuf());
+        original::iostream_loop(input.c_str(), out);
+        cerr.rdbuf(saved);
+        expected_errors = messages.str();
+    });
+    // Each version's output is kept and compared with that of the iostream loop
+    auto time_batch = [&](work_pool *p) {
+        string errors;
+        auto seconds = best_of(runs, [&] {
+            int fd = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            errors.clear();
+            batch(input.c_str(), fd, errors, p);
+            close(fd);
+        });
+        mapped_file a{ expected.c_str() }, b{ output.c_str() };
+        return pair{ seconds, a && b && (a.view() == b.view()) && (errors == expected_errors) };
+    };
+    auto [batch_time, batch_identical] = time_batch(nullptr);
+    auto [parallel_time, parallel_identical] = time_batch(&pool);
+    failures += !batch_identical + !parallel_identical;
+
+    auto parallel_name = "-j " + to_string(pool.size());
+    cout << lines << " lines, " << size / 1.0e6 << " MB, best of " << runs << " runs\n" << fixed << setprecision(3);
+    for (auto [name, seconds, identical] : { tuple{ "iostream", iostream_time, true },
+        tuple{ "batch", batch_time, batch_identical }, tuple{ parallel_name.c_str(), parallel_time, parallel_identical } }) {
+        cout << setw(10) << name << setw(10) << seconds << " s" << setw(10) << setprecision(1)
+            << size / seconds / 1.0e6 << " MB/s" << setw(10) << lines / seconds / 1.0e6 << " M lines/s"
+            << setw(8) << iostream_time / seconds << "x" << (identical ? "" : "  output DIFFERS") << '\n'
+            << setprecision(3);
+    }
+    for (const auto& file : { input, expected, output }) {
+        filesystem::remove(file);
+    }
+    return failures ? 1 : 0;
+}
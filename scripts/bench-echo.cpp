@@ -0,0 +1,153 @@
+// bench-echo.cpp : time 08-file1 against file-echo's copying methods, writing to a file, a pipe and /dev/null (POSIX)
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "mapped-file.h"
+using namespace std;
+
+// Runs a program with its standard output going to out, and if out is the
+// write end of a pipe, reads (and discards) what comes through it; returns
+// the seconds taken and the number of bytes read from the pipe
+pair<double, size_t> run(const vector<const char*>& command, int out, int pipe_read) {
+    auto start = chrono::steady_clock::now();
+    auto pid = fork();
+    if (pid == 0) {
+        dup2(out, STDOUT_FILENO);
+        if (pipe_read != -1) {
+            ::close(pipe_read);
+        }
+        execv(command[0], const_cast<char* const*>(command.data()));
+        _exit(127);
+    }
+    size_t received{};
+    if (pipe_read != -1) {
+        ::close(out);
+        vector<char> buffer(1 << 20);
+        for (ssize_t n; (n = ::read(pipe_read, buffer.data(), buffer.size())) > 0; ) {
+            received += n;
+        }
+        ::close(pipe_read);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+        cerr << "Failed: " << command[0] << '\n';
+        exit(1);
+    }
+    return { elapsed.count(), received };
+}
+
+int main(int argc, char *argv[]) {
+    size_t megabytes{ 256 }, runs{ 3 };
+    int i = 1;
+    for (; (i + 1 < argc) && (argv[i][0] == '-'); i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-s") {
+            megabytes = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else if (option == "-n") {
+            runs = max(1, atoi(argv[i + 1]));
+        }
+        else {
+            break;
+        }
+    }
+    if (i + 2 != argc) {
+        cerr << "Syntax: " << argv[0] << " [-s size in MB] [-n runs] <08-file1 program> <file-echo program>\n";
+        return 1;
+    }
+    const char *original = argv[i], *echo = argv[i + 1];
+
+    // Lines of random text, in a file next to where the copies go
+    string input{ "bench-echo-input.txt" }, output{ "bench-echo-output.txt" };
+    {
+        FILE *file = fopen(input.c_str(), "w");
+        mt19937 rng{ 1 };
+        uniform_int_distribution<int> letter{ 'a', 'z' }, length{ 1, 99 };
+        string line;
+        for (size_t size{}; size < megabytes << 20; size += line.size()) {
+            line.assign(length(rng), ' ');
+            for (auto& c : line) {
+                c = static_cast<char>(letter(rng));
+            }
+            line += '\n';
+            fputs(line.c_str(), file);
+        }
+        fclose(file);
+    }
+    auto size = mapped_file{ input.c_str() }.view().size();
+
+    struct candidate {
+        string name;
+        vector<const char*> command;
+    };
+    vector<candidate> candidates{ { "08-file1", { original, input.c_str(), nullptr } } };
+    for (const char *m : { "buffer", "copy_file_range", "sendfile", "splice" }) {
+        candidates.push_back({ "file-echo " + string{ m }, { echo, "-m", m, input.c_str(), nullptr } });
+    }
+    candidates.push_back({ "file-echo automatic", { echo, input.c_str(), nullptr } });
+
+    cout << size / 1.0e6 << " MB, best of " << runs << " runs, in GB/s (a method the kernel refuses falls back to buffer)\n"
+        << left << setw(28) << "" << right << setw(10) << "file" << setw(10) << "pipe" << setw(12) << "/dev/null\n";
+    bool all_identical = true;
+    for (const auto& c : candidates) {
+        cout << left << setw(28) << c.name << right << fixed << setprecision(2);
+        for (int target = 0; target != 3; ++target) {
+            double best{ 1.0e30 };
+            bool ok = true;
+            for (size_t r = 0; r != runs; ++r) {
+                int out, pipe_read{ -1 };
+                if (target == 0) {
+                    out = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                }
+                else if (target == 1) {
+                    int fds[2];
+                    if (pipe(fds) == -1) {
+                        return 1;
+                    }
+                    pipe_read = fds[0];
+                    out = fds[1];
+                }
+                else {
+                    out = ::open("/dev/null", O_WRONLY);
+                }
+                auto [seconds, received] = run(c.command, out, pipe_read);
+                if (target != 1) {
+                    ::close(out);
+                }
+                best = min(best, seconds);
+                if (target == 0) {
+                    mapped_file copy{ output.c_str() };
+                    ok = ok && (copy.view() == mapped_file{ input.c_str() }.view());
+                }
+                else if (target == 1) {
+                    ok = ok && (received == size);
+                }
+            }
+            if (ok) {
+                cout << setw(10) << size / best / 1.0e9;
+            }
+            else {
+                cout << setw(10) << "DIFFER";
+                all_identical = false;
+            }
+        }
+        cout << '\n';
+    }
+    ::unlink(input.c_str());
+    ::unlink(output.c_str());
+    return all_identical ? 0 : 1;
+}
@@ -0,0 +1,271 @@
+// bench-expr.cpp : time calc-bytecode.h, with and without its cache, against a tree-walking interpreter
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include "calc-engine.h"
+#include "calc-bytecode.h"
+using namespace std;
+
+// The usual alternative: a syntax tree with a virtual eval() per node, built
+// by a parser for the same grammar
+namespace tree {
+
+struct node {
+    virtual ~node() = default;
+    virtual double eval(const double *variables, calc::status& s) const = 0;
+};
+
+struct number : node {
+    double value;
+    explicit number(double value) : value{ value } {}
+    double eval(const double *, calc::status&) const override { return value; }
+};
+
+struct variable : node {
+    size_t slot;
+    explicit variable(size_t slot) : slot{ slot } {}
+    double eval(const double *variables, calc::status&) const override { return variables[slot]; }
+};
+
+struct negate : node {
+    unique_ptr<node> operand;
+    explicit negate(unique_ptr<node> operand) : operand{ move(operand) } {}
+    double eval(const double *variables, calc::status& s) const override { return -operand->eval(variables, s); }
+};
+
+struct binary : node {
+    char op;
+    unique_ptr<node> left, right;
+    binary(char op, unique_ptr<node> left, unique_ptr<node> right) : op{ op }, left{ move(left) }, right{ move(right) } {}
+    double eval(const double *variables, calc::status& s) const override {
+        auto x = left->eval(variables, s), y = right->eval(variables, s);
+        if ((op == '/') && (y == 0)) {
+            s = calc::status::divide_by_zero;
+            return 0;
+        }
+        return (op == '+') ? x + y : (op == '-') ? x - y : (op == '*') ? x * y : (op == '/') ? x / y : pow(x, y);
+    }
+};
+
+class parser {
+public:
+    parser(string_view text, const calc::bytecode::symbol_table& variables)
+        : p{ text.data() }, end{ text.data() + text.size() }, variables{ variables } {}
+    unique_ptr<node> parse() { return sum(); }
+private:
+    char peek() {
+        p = calc::skip_space(p, end);
+        return (p != end) ? *p : '\0';
+    }
+    unique_ptr<node> sum() {
+        auto left = product();
+        for (char c = peek(); (c == '+') || (c == '-'); c = peek()) {
+            ++p;
+            left = make_unique<binary>(c, move(left), product());
+        }
+        return left;
+    }
+    unique_ptr<node> product() {
+        auto left = unary();
+        for (char c = peek(); (c == '*') || (c == '/'); c = peek()) {
+            ++p;
+            left = make_unique<binary>(c, move(left), unary());
+        }
+        return left;
+    }
+    unique_ptr<node> unary() {
+        if (peek() == '-') {
+            ++p;
+            return make_unique<negate>(unary());
+        }
+        auto left = primary();
+        if (peek() == '^') {
+            ++p;
+            return make_unique<binary>('^', move(left), unary());
+        }
+        return left;
+    }
+    unique_ptr<node> primary() {
+        if (peek() == '(') {
+            ++p;
+            auto inner = sum();
+            peek();
+            ++p;
+            return inner;
+        }
+        if (calc::bytecode::is_identifier_start(peek())) {
+            auto start = p;
+            while ((p != end) && calc::bytecode::is_identifier(*p)) {
+                ++p;
+            }
+            return make_unique<variable>(*variables.find({ start, static_cast<size_t>(p - start) }));
+        }
+        double value{};
+        calc::parse_number(p, end, value);
+        return make_unique<number>(value);
+    }
+    const char *p, *end;
+    const calc::bytecode::symbol_table& variables;
+};
+
+} // namespace tree
+
+// Random formulas over the variables a to h, of which each line uses one
+string random_expression(mt19937& rng, int depth) {
+    uniform_int_distribution<int> choice{ 0, 9 }, digit{ 1, 99 };
+    auto c = choice(rng);
+    if ((depth == 0) || (c < 2)) {
+        return (c % 2) ? string(1, static_cast<char>('a' + c % 8)) : to_string(digit(rng)) + ".5";
+    }
+    auto left = random_expression(rng, depth - 1), right = random_expression(rng, depth - 1);
+    switch (c) {
+    case 2:
+        return "-" + left;
+    case 3:
+        return "(" + left + " + " + right + ")";
+    case 4:
+        return left + " ^ 2";
+    case 5:
+    case 6:
+        return left + " * " + right;
+    case 7:
+        return left + " / " + right;
+    default:
+        return left + ((c == 8) ? " + " : " - ") + right;
+    }
+}
+
+double best_of(size_t runs, const function<void()>& f) {
+    double best{ 1.0e30 };
+    for (size_t i = 0; i != runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    size_t lines{ 1000000 }, formulas{ 100 }, runs{ 3 };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-l") {
+            lines = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (option == "-f") {
+            formulas = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else if (option == "-n") {
+            runs = max(1, atoi(argv[i + 1]));
+        }
+    }
+    mt19937 rng{ 42 };
+    calc::bytecode::symbol_table variables;
+    for (char name = 'a'; name != 'i'; ++name) {
+        variables.assign(string_view{ &name, 1 }, uniform_real_distribution<double>{ -10, 10 }(rng));
+    }
+    vector<string> pool;
+    for (size_t i = 0; i != formulas; ++i) {
+        pool.push_back(random_expression(rng, 5));
+    }
+    vector<string_view> input;
+    uniform_int_distribution<size_t> pick{ 0, formulas - 1 };
+    for (size_t i = 0; i != lines; ++i) {
+        input.push_back(pool[pick(rng)]);
+    }
+
+    // Each method parses (or looks up) and evaluates every line, giving the
+    // same results bit for bit
+    vector<double> tree_results(lines), compiled_results(lines), cached_results(lines);
+    calc::status s;
+    auto tree_time = best_of(runs, [&] {
+        for (size_t i = 0; i != lines; ++i) {
+            tree_results[i] = tree::parser{ input[i], variables }.parse()->eval(variables.data(), s);
+        }
+    });
+    auto compiled_time = best_of(runs, [&] {
+        calc::bytecode::program program;
+        string error;
+        for (size_t i = 0; i != lines; ++i) {
+            calc::bytecode::compiler{ input[i], variables }.compile(program, error);
+            compiled_results[i] = calc::bytecode::run(program, variables.data(), s);
+        }
+    });
+    calc::bytecode::program_cache cache;
+    auto cached_time = best_of(runs, [&] {
+        string error;
+        for (size_t i = 0; i != lines; ++i) {
+            cached_results[i] = calc::bytecode::run(*cache.get(input[i], variables, error), variables.data(), s);
+        }
+    });
+
+    // Evaluation alone, of trees and programs built beforehand
+    vector<unique_ptr<tree::node>> trees;
+    vector<calc::bytecode::program> programs(formulas);
+    size_t instructions{};
+    for (size_t i = 0; i != formulas; ++i) {
+        trees.push_back(tree::parser{ pool[i], variables }.parse());
+        string error;
+        calc::bytecode::compiler{ pool[i], variables }.compile(programs[i], error);
+        instructions += programs[i].code.size();
+    }
+    double sum_tree{}, sum_bytecode{};
+    auto tree_eval_time = best_of(runs, [&] {
+        sum_tree = 0;
+        for (size_t i = 0; i != lines; ++i) {
+            sum_tree += trees[i % formulas]->eval(variables.data(), s);
+        }
+    });
+    auto bytecode_eval_time = best_of(runs, [&] {
+        sum_bytecode = 0;
+        for (size_t i = 0; i != lines; ++i) {
+            sum_bytecode += calc::bytecode::run(programs[i % formulas], variables.data(), s);
+        }
+    });
+
+    // Nesting within the limit compiles, and far beyond it is rejected rather
+    // than overflowing the stack
+    bool nesting_ok = true;
+    for (auto [depth, valid] : { pair{ calc::bytecode::max_nesting / 2, true }, pair{ size_t{ 2000000 }, false } }) {
+        for (auto [open, close] : { pair{ "(", ")" }, pair{ "-", "" } }) {
+            string text;
+            for (size_t i = 0; i != depth; ++i) {
+                text += open;
+            }
+            text += '1';
+            for (size_t i = 0; i != depth; ++i) {
+                text += close;
+            }
+            calc::bytecode::program program;
+            string error;
+            bool compiled = calc::bytecode::compiler{ text, variables }.compile(program, error);
+            nesting_ok = nesting_ok && (compiled == valid) && (valid || (error == "expression too complex"))
+                && (!valid || (calc::bytecode::run(program, variables.data(), s) == 1.0));
+        }
+    }
+
+    bool identical = (memcmp(tree_results.data(), compiled_results.data(), lines * sizeof(double)) == 0)
+        && (memcmp(tree_results.data(), cached_results.data(), lines * sizeof(double)) == 0)
+        && (memcmp(&sum_tree, &sum_bytecode, sizeof(double)) == 0);
+    cout << lines << " lines using " << formulas << " formulas (" << instructions / formulas
+        << " instructions each on average), best of " << runs << " runs\n" << fixed << setprecision(1);
+    for (auto [name, seconds] : { pair{ "parse to tree and walk", tree_time }, pair{ "compile and run", compiled_time },
+        pair{ "cache and run", cached_time }, pair{ "walk prebuilt tree", tree_eval_time },
+        pair{ "run prebuilt bytecode", bytecode_eval_time } }) {
+        cout << setw(24) << name << setw(10) << seconds * 1.0e9 / lines << " ns/line\n";
+    }
+    cout << "Cache: " << cache.misses() << " compiled, " << cache.hits() << " found\n"
+        << "Results " << (identical ? "identical" : "DIFFER") << ", deep nesting "
+        << (nesting_ok ? "handled" : "MISHANDLED") << '\n';
+    return (identical && nesting_ok) ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// bench-format.cpp : time formatting 08-calc output with ostream and to_chars, and check round-trip output reads back exactly
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <bit>
+#include <iostream>
+#include <iomanip>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include "calc-engine.h"
+using namespace std;
+
+struct line {
+    calc::job j;
+    double r;
+};
+
+// Calculations such as run-bench generates, with results as calc() gives them
+vector<line> make_lines(size_t count) {
+    mt19937 rng{ 42 };
+    uniform_int_distribution<int> number{ -1000, 1000 }, op{ 0, 4 };
+    vector<line> lines;
+    for (size_t i = 0; i != count; ++i) {
+        calc::job j{ static_cast<double>(number(rng)), static_cast<double>(abs(number(rng)) % 7 + 1), "+-*/^"[op(rng)] };
+        calc::status s;
+        lines.push_back({ j, calc::evaluate(j, s) });
+    }
+    return lines;
+}
+
+double best_of(size_t runs, const function<void()>& f) {
+    double best{ 1.0e30 };
+    for (size_t i = 0; i != runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+bool same(double a, double b) {
+    return (bit_cast<uint64_t>(a) == bit_cast<uint64_t>(b)) || (isnan(a) && isnan(b));
+}
+
+// Reads back every number of output in the round-trip format, three to a
+// line as "x op y = r", counting any which differ from those written
+size_t check_round_trip(string_view text, const vector<double>& values) {
+    size_t wrong{}, i{};
+    auto p = text.data(), end = p + text.size();
+    auto read = [&](string_view after) {
+        double value{};
+        auto [next, ec] = from_chars(p, end, value);
+        if ((ec != errc{}) || (i == values.size()) || !same(value, values[i])) {
+            if (wrong++ < 10) {
+                cerr << "Read back \"" << string_view{ p, static_cast<size_t>(next - p) } << "\" for "
+                    << setprecision(17) << ((i < values.size()) ? values[i] : 0.0) << '\n';
+            }
+        }
+        ++i;
+        p = next;
+        if (string_view{ p, static_cast<size_t>(end - p) }.starts_with(after)) {
+            p += after.size();
+            return true;
+        }
+        return false;
+    };
+    while ((p != end) && read(" ") && (end - p > 2) && ((p += 2), read(" = ")) && read("\n")) {
+    }
+    return wrong + ((p != end) || (i != values.size()));
+}
+
+int main(int argc, char *argv[]) {
+    size_t count{ 2000000 }, runs{ 3 }, random_values{ 1000000 };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-l") {
+            count = strtoull(argv[i + 1], nullptr, 10);
+        }
+        else if (option == "-n") {
+            runs = max(1, atoi(argv[i + 1]));
+        }
+        else if (option == "-c") {
+            random_values = strtoull(argv[i + 1], nullptr, 10);
+        }
+    }
+    auto lines = make_lines(count);
+
+    // ostream as 08-calc uses it, and with the 17 digits it needs to round-trip
+    string ostream6, ostream17, chars6, chars_shortest;
+    for (int precision : { 6, 17 }) {
+        auto seconds = best_of(runs, [&] {
+            ostringstream out;
+            out << setprecision(precision);
+            for (const auto& l : lines) {
+                out << l.j.x << ' ' << l.j.op << ' ' << l.j.y << " = " << l.r << '\n';
+            }
+            ((precision == 6) ? ostream6 : ostream17) = move(out).str();
+        });
+        cout << "ostream, precision " << setw(2) << precision << setw(10) << fixed << setprecision(1)
+            << seconds * 1.0e9 / count << " ns/line" << setw(8) << setprecision(0)
+            << ((precision == 6) ? ostream6 : ostream17).size() / seconds / 1.0e6 << " MB/s\n";
+    }
+    // to_chars into a reused output buffer, as calc-batch does
+    for (auto format : { calc::output_format::cout, calc::output_format::round_trip }) {
+        calc::output_buffer out{ -1 };
+        out.reserve(count * calc::max_line_length);
+        auto seconds = best_of(runs, [&] {
+            out.commit(out.view().data());
+            for (const auto& l : lines) {
+                out.commit(calc::format_line(out.reserve(calc::max_line_length), l.j, l.r, format));
+            }
+        });
+        auto& text = (format == calc::output_format::cout) ? chars6 : chars_shortest;
+        text = out.view();
+        cout << ((format == calc::output_format::cout) ? "to_chars, precision 6 " : "to_chars, shortest    ")
+            << setw(10) << setprecision(1) << seconds * 1.0e9 / count << " ns/line" << setw(8) << setprecision(0)
+            << text.size() / seconds / 1.0e6 << " MB/s\n";
+    }
+    cout << defaultfloat << setprecision(6);
+
+    // The round-trip check covers the benchmark's output, values chosen to be
+    // awkward, and random bit patterns
+    vector<double> values;
+    for (const auto& l : lines) {
+        values.insert(values.end(), { l.j.x, l.j.y, l.r });
+    }
+    using limits = numeric_limits<double>;
+    vector<double> awkward{ 0.0, -0.0, 0.1, 0.1 + 0.2, 1.0 / 3.0, 2.0 / 3.0, 1e23, 9007199254740993.0, 5e-324,
+        limits::min(), limits::max(), limits::denorm_min(), limits::epsilon(), limits::infinity(),
+        -limits::infinity(), limits::quiet_NaN(), nextafter(1.0, 2.0), nextafter(1.0, 0.0), 123456789012345678.0 };
+    for (int e = -320; e <= 308; ++e) {
+        awkward.push_back(pow(10.0, e));
+    }
+    mt19937_64 rng{ 1 };
+    for (size_t i = 0; i != random_values; ++i) {
+        auto value = bit_cast<double>(rng());
+        awkward.push_back(isfinite(value) ? value : 0.0);
+    }
+    while (awkward.size() % 3) {
+        awkward.push_back(1.0);
+    }
+    calc::output_buffer extra{ -1 };
+    for (size_t i = 0; i != awkward.size(); i += 3) {
+        extra.commit(calc::format_line(extra.reserve(calc::max_line_length), { awkward[i], awkward[i + 1], '+' },
+            awkward[i + 2], calc::output_format::round_trip));
+    }
+    values.insert(values.end(), awkward.begin(), awkward.end());
+    auto wrong = check_round_trip(chars_shortest + string{ extra.view() }, values);
+    cout << "Precision 6 output " << ((chars6 == ostream6) ? "identical to" : "DIFFERS from") << " ostream's\n"
+        << "Round trip: " << values.size() << " values read back, " << wrong << " differ\n"
+        << "Output size: " << ostream6.size() << " bytes with 6 digits, " << ostream17.size() << " with 17, "
+        << chars_shortest.size() << " shortest\n";
+    return (wrong || (chars6 != ostream6)) ? 1 : 0;
+}
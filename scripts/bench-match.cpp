@@ -0,0 +1,137 @@
+// bench-match.cpp : time std::regex against static-match.h for scanning Markdown code blocks
+
+#include <string>
+#include <string_view>
+#include <regex>
+#include <array>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include "mapped-file.h"
+#include "static-match.h"
+using namespace std;
+
+// Each scanner returns the number of filename headers found after a fence line
+size_t scan_regex_per_block(string_view text) {
+    line_reader lines{ text };
+    string_view line;
+    size_t found{};
+    while (lines.getline(line)) {
+        if ((line != "```cpp") && (line != "```")) {
+            continue;
+        }
+        lines.getline(line);
+        regex is_cpp { R"(^// ([[:alnum:]_-]+\.cpp) :)" };
+        cmatch matches;
+        if (regex_search(line.data(), line.data() + line.size(), matches, is_cpp)) {
+            ++found;
+        }
+    }
+    return found;
+}
+
+size_t scan_regex_hoisted(string_view text) {
+    static const regex is_cpp { R"(^// ([[:alnum:]_-]+\.cpp) :)" };
+    line_reader lines{ text };
+    string_view line;
+    size_t found{};
+    while (lines.getline(line)) {
+        if ((line != "```cpp") && (line != "```")) {
+            continue;
+        }
+        lines.getline(line);
+        cmatch matches;
+        if (regex_search(line.data(), line.data() + line.size(), matches, is_cpp)) {
+            ++found;
+        }
+    }
+    return found;
+}
+
+size_t scan_static(string_view text) {
+    line_reader lines{ text };
+    string_view line;
+    size_t found{};
+    while (lines.getline(line)) {
+        if (!pattern::full_match<plain_fence>(line) && !pattern::full_match<cpp_fence>(line)) {
+            continue;
+        }
+        lines.getline(line);
+        array<string_view, 1> matches;
+        if (pattern::match_prefix<filename_header>(line, matches)) {
+            ++found;
+        }
+    }
+    return found;
+}
+
+// Every line tested against the filename pattern, to isolate matcher cost from fence skipping
+size_t all_lines_regex(string_view text) {
+    static const regex is_cpp { R"(^// ([[:alnum:]_-]+\.cpp) :)" };
+    line_reader lines{ text };
+    string_view line;
+    size_t found{};
+    cmatch matches;
+    while (lines.getline(line)) {
+        found += regex_search(line.data(), line.data() + line.size(), matches, is_cpp);
+    }
+    return found;
+}
+
+size_t all_lines_static(string_view text) {
+    line_reader lines{ text };
+    string_view line;
+    size_t found{};
+    array<string_view, 1> matches;
+    while (lines.getline(line)) {
+        found += pattern::match_prefix<filename_header>(line, matches);
+    }
+    return found;
+}
+
+int main(const int argc, const char **argv) {
+    if (argc < 3) {
+        cerr << "Syntax: " << argv[0] << " <repeat count> <Markdown file>...\n";
+        return 1;
+    }
+    int repeat = atoi(argv[1]);
+    string corpus;
+    for (int i = 2; i != argc; ++i) {
+        mapped_file input_file{ argv[i] };
+        if (!input_file) {
+            cerr << "Error opening file: " << argv[i] << '\n';
+            return 1;
+        }
+        corpus += input_file.view();
+    }
+    string text;
+    text.reserve(corpus.size() * repeat);
+    for (int i = 0; i != repeat; ++i) {
+        text += corpus;
+    }
+
+    struct scanner {
+        const char *name;
+        function<size_t(string_view)> scan;
+    };
+    vector<scanner> scanners{
+        { "regex, built per block", scan_regex_per_block },
+        { "regex, built once", scan_regex_hoisted },
+        { "static-match", scan_static },
+        { "regex, every line", all_lines_regex },
+        { "static-match, every line", all_lines_static },
+    };
+    auto megabytes = text.size() / 1.0e6;
+    cout << "Input: " << fixed << setprecision(1) << megabytes << " MB\n";
+    for (const auto& s : scanners) {
+        auto start = chrono::steady_clock::now();
+        auto found = s.scan(text);
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        cout << setw(28) << left << s.name << right << setw(10) << setprecision(3) << elapsed.count() << " s"
+            << setw(10) << setprecision(1) << megabytes / elapsed.count() << " MB/s"
+            << setw(10) << found << " matches\n";
+    }
+}
@@ -0,0 +1,242 @@
+// bench-server.cpp : load generator for calc-server, reporting latency percentiles and throughput (Linux only)
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "calc-engine.h"
+using namespace std;
+
+using clock_type = chrono::steady_clock;
+
+// The requests for one connection, with the reply expected for each
+struct workload {
+    string requests;
+    vector<size_t> ends;        // of each request in requests
+    vector<string> expected;
+};
+
+workload make_workload(size_t count, unsigned seed) {
+    mt19937 rng{ seed };
+    uniform_int_distribution<int> number{ -1000, 1000 }, op{ 0, 9 };
+    workload w;
+    char line[calc::max_line_length];
+    for (size_t i = 0; i != count; ++i) {
+        calc::job j{ static_cast<double>(number(rng)), static_cast<double>(abs(number(rng)) % 7), "+-*/^+-*/%"[op(rng)] };
+        auto p = line;
+        p = to_chars(p, p + 16, j.x).ptr;
+        p = copy_n(" ?  ", 3, p);
+        p[-2] = j.op;
+        p = to_chars(p, p + 16, j.y).ptr;
+        *p++ = '\n';
+        w.requests.append(line, p);
+        w.ends.push_back(w.requests.size());
+        calc::status s;
+        auto r = calc::evaluate(j, s);
+        w.expected.push_back((s == calc::status::ok) ? string(line, calc::format_line(line, j, r)) : calc::message(s));
+    }
+    return w;
+}
+
+struct connection_result {
+    vector<double> latencies;   // in microseconds
+    size_t wrong{};
+    string error;
+};
+
+bool write_all(int fd, const char *data, size_t size) {
+    while (size) {
+        auto n = ::write(fd, data, size);
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Keeps depth requests outstanding on one connection: whenever replies come
+// in, the same number of new requests are sent together
+void run_connection(const char *path, const workload& w, size_t depth, connection_result& result) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+    if ((fd == -1) || (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)) {
+        result.error = "cannot connect to "s + path + ": " + strerror(errno);
+        if (fd != -1) {
+            ::close(fd);
+        }
+        return;
+    }
+    auto count = w.ends.size();
+    deque<clock_type::time_point> sent;
+    size_t next{}, done{};
+    auto send_up_to = [&](size_t last) {
+        last = min(last, count);
+        if (last == next) {
+            return true;
+        }
+        auto begin = next ? w.ends[next - 1] : 0;
+        auto now = clock_type::now();
+        for (; next != last; ++next) {
+            sent.push_back(now);
+        }
+        return write_all(fd, w.requests.data() + begin, w.ends[last - 1] - begin);
+    };
+    result.latencies.reserve(count);
+    string in;
+    char buffer[65536];
+    if (!send_up_to(depth)) {
+        result.error = "write failed";
+    }
+    while (result.error.empty() && (done != count)) {
+        auto n = ::read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            result.error = "connection closed after "s + to_string(done) + " replies";
+            break;
+        }
+        auto now = clock_type::now();
+        in.append(buffer, n);
+        size_t start{};
+        for (size_t newline; (newline = in.find('\n', start)) != string::npos; start = newline + 1) {
+            result.latencies.push_back(chrono::duration<double, micro>(now - sent.front()).count());
+            sent.pop_front();
+            if (string_view{ in }.substr(start, newline + 1 - start) != w.expected[done]) {
+                ++result.wrong;
+            }
+            ++done;
+        }
+        in.erase(0, start);
+        if (!send_up_to(done + depth)) {
+            result.error = "write failed";
+        }
+    }
+    ::close(fd);
+}
+
+// For comparison, the cost of starting a program such as 08-calc for every
+// job, given a file holding a single calculation
+vector<double> run_processes(const char *program, size_t count) {
+    char path[]{ "/tmp/bench-server-XXXXXX" };
+    int fd = mkstemp(path);
+    write_all(fd, "1 + 2", 5);
+    ::close(fd);
+    vector<double> latencies;
+    for (size_t i = 0; i != count; ++i) {
+        auto start = clock_type::now();
+        auto pid = fork();
+        if (pid == 0) {
+            int null = ::open("/dev/null", O_WRONLY);
+            dup2(null, 1);
+            dup2(null, 2);
+            execl(program, program, path, nullptr);
+            _exit(127);
+        }
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || (WEXITSTATUS(status) == 127)) {
+            cerr << "Could not run " << program << '\n';
+            break;
+        }
+        latencies.push_back(chrono::duration<double, micro>(clock_type::now() - start).count());
+    }
+    ::unlink(path);
+    return latencies;
+}
+
+void report(const char *name, vector<double>& latencies, double seconds) {
+    if (latencies.empty()) {
+        return;
+    }
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]; };
+    cout << left << setw(12) << name << right << fixed << setprecision(1)
+        << setw(10) << percentile(0.5) << setw(10) << percentile(0.9) << setw(10) << percentile(0.99)
+        << setw(10) << percentile(0.999) << setw(12) << latencies.back()
+        << setprecision(0) << setw(14) << latencies.size() / seconds << '\n';
+}
+
+int main(int argc, char *argv[]) {
+    size_t connections{ 16 }, requests{ 100000 }, depth{ 16 }, processes{ 200 };
+    const char *program{};
+    int i = 1;
+    for (; (i + 1 < argc) && (argv[i][0] == '-'); i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-c") {
+            connections = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else if (option == "-n") {
+            requests = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else if (option == "-d") {
+            depth = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else if (option == "-x") {
+            program = argv[i + 1];
+        }
+        else if (option == "-p") {
+            processes = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else {
+            break;
+        }
+    }
+    if (i + 1 != argc) {
+        cerr << "Syntax: " << argv[0] << " [-c connections] [-n requests per connection] [-d requests in flight per connection]\n"
+            << "    [-x 08-calc program to compare with] [-p runs of it] <socket path>\n";
+        return 1;
+    }
+    vector<workload> workloads;
+    for (size_t c = 0; c != connections; ++c) {
+        workloads.push_back(make_workload(requests, static_cast<unsigned>(c + 1)));
+    }
+    vector<connection_result> results(connections);
+    vector<thread> threads;
+    auto start = clock_type::now();
+    for (size_t c = 0; c != connections; ++c) {
+        threads.emplace_back(run_connection, argv[i], cref(workloads[c]), depth, ref(results[c]));
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    chrono::duration<double> elapsed = clock_type::now() - start;
+
+    vector<double> latencies;
+    size_t wrong{};
+    for (auto& r : results) {
+        if (!r.error.empty()) {
+            cerr << "Error: " << r.error << '\n';
+        }
+        latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+        wrong += r.wrong;
+    }
+    cout << connections << " connections, " << requests << " requests each, " << depth << " in flight on each\n"
+        << "Latency (us):    p50       p90       p99     p99.9         max  requests/s\n";
+    report("server", latencies, elapsed.count());
+    if (program) {
+        start = clock_type::now();
+        auto spawned = run_processes(program, processes);
+        elapsed = clock_type::now() - start;
+        report("process/job", spawned, elapsed.count());
+    }
+    if (wrong) {
+        cout << wrong << " replies differed from those expected\n";
+    }
+    return (wrong || (latencies.size() != connections * requests)) ? 1 : 0;
+}
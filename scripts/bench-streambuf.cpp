@@ -0,0 +1,165 @@
+// bench-streambuf.cpp : time the reading loops of 08-file1, 08-file2 and 08-line3 with std::filebuf and large_filebuf
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "large-filebuf.h"
+using namespace std;
+
+double best_of(size_t runs, const function<void()>& f) {
+    double best{ 1.0e30 };
+    for (size_t i = 0; i != runs; ++i) {
+        auto start = chrono::steady_clock::now();
+        f();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        best = min(best, elapsed.count());
+    }
+    return best;
+}
+
+// The byte count and the sum of the bytes, to check each way of reading
+// sees the same; cheap enough not to hide the cost of the reading itself
+struct checksum {
+    uint64_t count{}, sum{};
+    void add(char c) { ++count; sum += static_cast<unsigned char>(c); }
+    void add(string_view s) { for (char c : s) add(c); }
+    bool operator==(const checksum&) const = default;
+};
+
+struct reader {
+    const char *name;
+    function<checksum(istream&)> read;
+};
+
+// Each stream opens the file and passes itself to a reader
+struct stream {
+    string name;
+    function<checksum(const char*, const reader&)> open;
+};
+
+int main(int argc, char *argv[]) {
+    size_t megabytes{ 64 }, runs{ 3 };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string_view option{ argv[i] };
+        if (option == "-s") {
+            megabytes = max<size_t>(1, strtoull(argv[i + 1], nullptr, 10));
+        }
+        else if (option == "-n") {
+            runs = max(1, atoi(argv[i + 1]));
+        }
+    }
+
+    const char *filename = "bench-streambuf.txt";
+    {
+        ofstream file{ filename, ios_base::binary };
+        mt19937 rng{ 1 };
+        uniform_int_distribution<int> letter{ 'a', 'z' }, length{ 1, 99 };
+        string line;
+        for (size_t size{}; size < megabytes << 20; size += line.size()) {
+            line.assign(length(rng), ' ');
+            for (auto& c : line) {
+                c = static_cast<char>(letter(rng));
+            }
+            line += '\n';
+            file << line;
+        }
+    }
+
+    vector<reader> readers{
+        { "get() (08-file1)", [](istream& in) {
+            checksum result;
+            for (int c = in.get(); c != istream::traits_type::eof(); c = in.get()) {
+                result.add(static_cast<char>(c));
+            }
+            return result;
+        } },
+        { ">> noskipws (08-file2)", [](istream& in) {
+            checksum result;
+            char c;
+            while (in >> noskipws >> c) {
+                result.add(c);
+            }
+            return result;
+        } },
+        { "rdbuf()->sbumpc()", [](istream& in) {
+            checksum result;
+            auto buffer = in.rdbuf();
+            for (int c = buffer->sbumpc(); c != istream::traits_type::eof(); c = buffer->sbumpc()) {
+                result.add(static_cast<char>(c));
+            }
+            return result;
+        } },
+        { "getline() (08-line3)", [](istream& in) {
+            checksum result;
+            string s;
+            getline(in, s, '\0');
+            result.add(s);
+            return result;
+        } },
+        { "read() 1 MiB blocks", [](istream& in) {
+            checksum result;
+            vector<char> block(1 << 20);
+            while (in.read(block.data(), block.size()) || in.gcount()) {
+                result.add(string_view{ block.data(), static_cast<size_t>(in.gcount()) });
+            }
+            return result;
+        } },
+    };
+
+    vector<stream> streams{
+        { "ifstream", [](const char *f, const reader& r) {
+            ifstream in{ f };
+            return r.read(in);
+        } },
+        { "ifstream, 1 MiB pubsetbuf", [](const char *f, const reader& r) {
+            vector<char> buffer(1 << 20);
+            ifstream in;
+            in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+            in.open(f);
+            return r.read(in);
+        } },
+    };
+    for (size_t size : { 64 << 10, 1 << 20, 16 << 20 }) {
+        streams.push_back({ "large_ifstream, " + to_string(size >> 10) + " KiB", [size](const char *f, const reader& r) {
+            large_ifstream in{ f, size };
+            return r.read(in);
+        } });
+    }
+    streams.push_back({ "large_ifstream, no fadvise", [](const char *f, const reader& r) {
+        large_ifstream in{ f, large_filebuf::default_buffer_size, false };
+        return r.read(in);
+    } });
+
+    cout << (megabytes << 20) / 1.0e6 << " MB, best of " << runs << " runs, in MB/s\n" << setw(28) << "";
+    for (const auto& r : readers) {
+        cout << setw(23) << r.name;
+    }
+    cout << '\n' << fixed << setprecision(0);
+    checksum expected;
+    bool identical = true;
+    for (const auto& s : streams) {
+        cout << left << setw(28) << s.name << right;
+        for (const auto& r : readers) {
+            checksum result;
+            auto seconds = best_of(runs, [&] { result = s.open(filename, r); });
+            if (!expected.count) {
+                expected = result;
+            }
+            identical = identical && (result == expected);
+            cout << setw(23) << result.count / seconds / 1.0e6;
+        }
+        cout << '\n';
+    }
+    cout << expected.count << " bytes read each time; results " << (identical ? "identical" : "DIFFER") << '\n';
+    remove(filename);
+    return identical ? 0 : 1;
+}
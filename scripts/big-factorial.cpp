@@ -0,0 +1,20 @@
+// big-factorial.cpp : 04-constexpr.cpp's factorial for any size of number, using bigint.h
+
+#include <iostream>
+#include <cstdlib>
+#include "bigint.h"
+using namespace std;
+
+// factorial() in 04-constexpr.cpp overflows an int beyond 12!; this one is
+// exact for any n, which is read as there or given on the command line
+int main(int argc, const char *argv[]) {
+    long long n{};
+    if (argc == 2) {
+        n = atoll(argv[1]);
+    }
+    else {
+        cout << "Please enter a number: ";
+        cin >> n;
+    }
+    cout << n << "! = " << factorial(max(n, 0LL)) << '\n';
+}
@@ -0,0 +1,327 @@
+// bigint.h : arbitrary-precision integers, with Karatsuba multiplication and exponentiation by squaring
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+#include <compare>
+#include <ostream>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+
+// A sign and a magnitude, held as 32-bit limbs with the least significant
+// first and no leading zero limbs (so zero has none)
+class big_integer {
+public:
+    using limb = std::uint32_t;
+
+    // Operands with fewer limbs than this are multiplied the schoolbook way
+    static inline std::size_t karatsuba_threshold = 40;
+
+    big_integer() = default;
+
+    big_integer(long long value) : negative{ value < 0 } {
+        auto magnitude = negative ? 0 - static_cast<unsigned long long>(value) : static_cast<unsigned long long>(value);
+        for (; magnitude; magnitude >>= 32) {
+            limbs.push_back(static_cast<limb>(magnitude));
+        }
+    }
+
+    // value must be finite and a whole number, which every double of 2^53 or
+    // more is
+    static big_integer from_double(double value) {
+        if (std::abs(value) < 0x1p63) {
+            return big_integer{ static_cast<long long>(value) };
+        }
+        int exponent;
+        auto fraction = std::frexp(std::abs(value), &exponent);
+        big_integer result{ static_cast<long long>(std::ldexp(fraction, 53)) };
+        result.shift_left(exponent - 53);
+        result.negative = value < 0;
+        return result;
+    }
+
+    bool is_zero() const { return limbs.empty(); }
+    bool is_negative() const { return negative; }
+
+    std::size_t bits() const {
+        return limbs.empty() ? 0 : (limbs.size() - 1) * 32 + std::bit_width(limbs.back());
+    }
+
+    big_integer operator-() const {
+        auto result = *this;
+        result.negative = !negative && !is_zero();
+        return result;
+    }
+
+    big_integer& operator+=(const big_integer& other) { return add(other, other.negative); }
+    big_integer& operator-=(const big_integer& other) { return add(other, !other.negative); }
+
+    big_integer& operator*=(const big_integer& other) {
+        negative = (negative != other.negative);
+        if (other.limbs.size() == 1) {
+            multiply_small(limbs, other.limbs.front());
+        }
+        else {
+            limbs = multiply(limbs, other.limbs);
+        }
+        negative = negative && !is_zero();
+        return *this;
+    }
+
+    friend big_integer operator+(big_integer a, const big_integer& b) { return a += b; }
+    friend big_integer operator-(big_integer a, const big_integer& b) { return a -= b; }
+    friend big_integer operator*(big_integer a, const big_integer& b) { return a *= b; }
+
+    friend bool operator==(const big_integer&, const big_integer&) = default;
+
+    friend std::strong_ordering operator<=>(const big_integer& a, const big_integer& b) {
+        if (a.negative != b.negative) {
+            return b.negative <=> a.negative;
+        }
+        auto order = compare(a.limbs, b.limbs);
+        return a.negative ? 0 <=> order : order <=> 0;
+    }
+
+    void shift_left(std::size_t bits) {
+        if (is_zero() || !bits) {
+            return;
+        }
+        auto whole = bits / 32, part = bits % 32;
+        if (part) {
+            limbs.push_back(0);
+            for (auto i = limbs.size() - 1; i != 0; --i) {
+                limbs[i] = (limbs[i] << part) | (limbs[i - 1] >> (32 - part));
+            }
+            limbs[0] <<= part;
+            trim(limbs);
+        }
+        limbs.insert(limbs.begin(), whole, 0);
+    }
+
+    // In decimal, nine digits at a time by dividing by 10^9 (which is
+    // quadratic in the number of limbs)
+    std::string to_string() const {
+        if (is_zero()) {
+            return "0";
+        }
+        std::vector<limb> quotient{ limbs };
+        std::vector<limb> groups;
+        while (!quotient.empty()) {
+            std::uint64_t remainder{};
+            for (auto i = quotient.size(); i-- != 0; ) {
+                auto current = (remainder << 32) | quotient[i];
+                quotient[i] = static_cast<limb>(current / 1000000000);
+                remainder = current % 1000000000;
+            }
+            trim(quotient);
+            groups.push_back(static_cast<limb>(remainder));
+        }
+        std::string result(negative ? "-" : "");
+        result.reserve(groups.size() * 9 + 1);
+        char digits[10];
+        auto end = std::to_chars(digits, digits + 10, groups.back()).ptr;
+        result.append(digits, end);
+        for (auto i = groups.size() - 1; i-- != 0; ) {
+            end = std::to_chars(digits, digits + 10, groups[i]).ptr;
+            result.append(9 - (end - digits), '0').append(digits, end);
+        }
+        return result;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const big_integer& n) { return os << n.to_string(); }
+
+private:
+    using magnitude = std::vector<limb>;
+    using digits = std::span<const limb>;
+
+    static void trim(magnitude& m) {
+        while (!m.empty() && !m.back()) {
+            m.pop_back();
+        }
+    }
+
+    static digits trimmed(digits d) {
+        while (!d.empty() && !d.back()) {
+            d = d.first(d.size() - 1);
+        }
+        return d;
+    }
+
+    static int compare(digits a, digits b) {
+        if (a.size() != b.size()) {
+            return (a.size() < b.size()) ? -1 : 1;
+        }
+        for (auto i = a.size(); i-- != 0; ) {
+            if (a[i] != b[i]) {
+                return (a[i] < b[i]) ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    // a += b << (32 * shift), with a made long enough
+    static void add_shifted(magnitude& a, digits b, std::size_t shift) {
+        if (a.size() < b.size() + shift) {
+            a.resize(b.size() + shift);
+        }
+        std::uint64_t carry{};
+        std::size_t i{};
+        for (; i != b.size(); ++i) {
+            carry += static_cast<std::uint64_t>(a[i + shift]) + b[i];
+            a[i + shift] = static_cast<limb>(carry);
+            carry >>= 32;
+        }
+        for (i += shift; carry; ++i) {
+            if (i == a.size()) {
+                a.push_back(0);
+            }
+            carry += a[i];
+            a[i] = static_cast<limb>(carry);
+            carry >>= 32;
+        }
+    }
+
+    // a -= b, where a is at least b
+    static void subtract(magnitude& a, digits b) {
+        std::int64_t borrow{};
+        std::size_t i{};
+        for (; i != b.size(); ++i) {
+            borrow += static_cast<std::int64_t>(a[i]) - b[i];
+            a[i] = static_cast<limb>(borrow);
+            borrow >>= 32;
+        }
+        for (; borrow; ++i) {
+            borrow += a[i];
+            a[i] = static_cast<limb>(borrow);
+            borrow >>= 32;
+        }
+        trim(a);
+    }
+
+    big_integer& add(const big_integer& other, bool other_negative) {
+        if (negative == other_negative) {
+            add_shifted(limbs, other.limbs, 0);
+        }
+        else if (compare(limbs, other.limbs) >= 0) {
+            subtract(limbs, other.limbs);
+        }
+        else {
+            auto result = other.limbs;
+            subtract(result, limbs);
+            limbs = std::move(result);
+            negative = other_negative;
+        }
+        negative = negative && !is_zero();
+        return *this;
+    }
+
+    static void multiply_small(magnitude& a, limb b) {
+        std::uint64_t carry{};
+        for (auto& x : a) {
+            carry += static_cast<std::uint64_t>(x) * b;
+            x = static_cast<limb>(carry);
+            carry >>= 32;
+        }
+        a.resize(b ? a.size() + (carry != 0) : 0, static_cast<limb>(carry));
+    }
+
+    static magnitude schoolbook(digits a, digits b) {
+        magnitude result(a.size() + b.size());
+        for (std::size_t i = 0; i != a.size(); ++i) {
+            std::uint64_t carry{};
+            for (std::size_t j = 0; j != b.size(); ++j) {
+                carry += static_cast<std::uint64_t>(a[i]) * b[j] + result[i + j];
+                result[i + j] = static_cast<limb>(carry);
+                carry >>= 32;
+            }
+            result[i + b.size()] = static_cast<limb>(carry);
+        }
+        trim(result);
+        return result;
+    }
+
+    // Splitting each operand into high and low halves, a * b is found from
+    // three half-size products: high * high, low * low and (high + low) * (high +
+    // low), from which the other two are subtracted to give the middle term.
+    // An operand less than half the length of the other is multiplied by each
+    // piece of it in turn.
+    static magnitude multiply(digits a, digits b) {
+        a = trimmed(a);
+        b = trimmed(b);
+        if (a.size() < b.size()) {
+            std::swap(a, b);
+        }
+        if (b.empty()) {
+            return {};
+        }
+        if (b.size() < karatsuba_threshold) {
+            return schoolbook(a, b);
+        }
+        magnitude result;
+        if (b.size() * 2 <= a.size()) {
+            for (std::size_t i = 0; i < a.size(); i += b.size()) {
+                auto piece = multiply(a.subspan(i, std::min(b.size(), a.size() - i)), b);
+                add_shifted(result, piece, i);
+            }
+            trim(result);
+            return result;
+        }
+        auto half = a.size() / 2;
+        auto a0 = a.first(half), a1 = a.subspan(half), b0 = b.first(half), b1 = b.subspan(half);
+        auto low = multiply(a0, b0), high = multiply(a1, b1);
+        magnitude a_sum{ a0.begin(), a0.end() }, b_sum{ b0.begin(), b0.end() };
+        add_shifted(a_sum, a1, 0);
+        add_shifted(b_sum, b1, 0);
+        auto middle = multiply(a_sum, b_sum);
+        subtract(middle, low);
+        subtract(middle, high);
+        result = std::move(low);
+        add_shifted(result, middle, half);
+        add_shifted(result, high, half * 2);
+        trim(result);
+        return result;
+    }
+
+    magnitude limbs;
+    bool negative{};
+};
+
+// Exponentiation by squaring: one squaring per bit of the exponent, and one
+// more multiplication per bit which is set
+inline big_integer pow(big_integer base, std::uint64_t exponent) {
+    big_integer result{ 1 };
+    while (exponent) {
+        if (exponent & 1) {
+            result *= base;
+        }
+        exponent >>= 1;
+        if (exponent) {
+            base *= base;
+        }
+    }
+    return result;
+}
+
+// The product of first to last inclusive, split in halves so that the two
+// numbers multiplied are of similar size, as Karatsuba multiplication needs
+inline big_integer product(std::uint64_t first, std::uint64_t last) {
+    if (last - first < 16) {
+        big_integer result{ 1 };
+        for (auto i = first; i <= last; ++i) {
+            result *= big_integer{ static_cast<long long>(i) };
+        }
+        return result;
+    }
+    auto middle = first + (last - first) / 2;
+    return product(first, middle) * product(middle + 1, last);
+}
+
+inline big_integer factorial(std::uint64_t n) {
+    return (n < 2) ? big_integer{ 1 } : product(2, n);
+}
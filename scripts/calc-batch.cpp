@@ -0,0 +1,129 @@
+// calc-batch.cpp : 08-calc for very large input files, memory-mapped and without iostreams
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include "mapped-file.h"
+#include "calc-engine.h"
+#include "calc-columnar.h"
+using namespace std;
+
+// A job file in the binary format is evaluated straight from its mapping, with
+// the results going to another such file (-o), or else printed as text; error
+// messages give the row number with -l
+int run_columnar(string_view file, const char *filename, const char *output, unsigned threads, bool line_numbers,
+    calc::output_format format) {
+    calc::columnar::columns jobs;
+    if (!calc::columnar::open_columns(file, jobs) || jobs.r) {
+        cerr << "Error: incomplete or invalid job file: " << filename << '\n';
+        return 1;
+    }
+    auto report = [&](uint64_t row, calc::status error) {
+        if (line_numbers) {
+            fprintf(stderr, "%s:%llu: ", filename, static_cast<unsigned long long>(row + 1));
+        }
+        fputs(calc::message(error), stderr);
+    };
+    if (output) {
+        auto h = calc::columnar::make_header(jobs.rows, true);
+        mapped_output results{ output, calc::columnar::file_size(h) };
+        if (!results) {
+            cerr << "Error creating file: " << output << '\n';
+            return 1;
+        }
+        auto columns = calc::columnar::lay_out(results.begin(), h);
+        work_pool pool{ threads };
+        calc::columnar::evaluate_file(jobs, columns, pool);
+        for (uint64_t row = 0; row != jobs.rows; ++row) {
+            if (columns.error[row] != calc::status::ok) {
+                report(row, columns.error[row]);
+            }
+        }
+        return 0;
+    }
+    calc::output_buffer out{ fileno(stdout) };
+    calc::column_scratch scratch;
+    vector<double> r(calc::block_size);
+    vector<calc::status> errors(calc::block_size);
+    for (uint64_t first = 0; first < jobs.rows; first += calc::block_size) {
+        auto n = min<uint64_t>(calc::block_size, jobs.rows - first);
+        calc::evaluate_columns(n, jobs.x + first, jobs.y + first, jobs.op + first, r.data(), errors.data(), scratch);
+        for (uint64_t i = 0; i != n; ++i) {
+            if (errors[i] != calc::status::ok) {
+                report(first + i, errors[i]);
+            }
+            if ((format != calc::output_format::exact_powers) || (jobs.op[first + i] != '^')
+                || !calc::format_exact_power(out, jobs.x[first + i], jobs.y[first + i])) {
+                out.commit(calc::format_line(out.reserve(calc::max_line_length), { jobs.x[first + i], jobs.y[first + i], jobs.op[first + i] }, r[i], format));
+            }
+        }
+    }
+    return 0;
+}
+
+// For text input, output (and error messages, with or without -l) are the same
+// as from 08-calc.cpp, including for an input file which cannot be opened; with
+// -j the file is evaluated in parts on N threads (all cores for -j 0); with -r
+// numbers are printed with as many digits as they need to read back exactly,
+// and with -b whole number powers are printed exactly, with every digit
+int main(int argc, const char *argv[]) {
+    bool line_numbers{};
+    auto format = calc::output_format::cout;
+    unsigned threads{ 1 };
+    const char *output{};
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i) {
+        string_view option{ argv[i] };
+        if (option == "-l") {
+            line_numbers = true;
+        }
+        else if (option == "-r") {
+            format = calc::output_format::round_trip;
+        }
+        else if (option == "-b") {
+            format = calc::output_format::exact_powers;
+        }
+        else if ((option == "-o") && (i + 1 < argc)) {
+            output = argv[++i];
+        }
+        else if ((option == "-j") && (i + 1 < argc)) {
+            threads = atoi(argv[++i]);
+        }
+        else if (option.starts_with("-j")) {
+            threads = atoi(argv[i] + 2);
+        }
+        else {
+            break;
+        }
+    }
+    if (i + 1 != argc) {
+        cerr << "Syntax: " << argv[0] << " [-l] [-r | -b] [-j N] [-o binary results file] <input file name>\n";
+        return 1;
+    }
+    mapped_file input{ argv[i] };
+    if (calc::columnar::is_columnar(input.view())) {
+        return run_columnar(input.view(), argv[i], output, threads, line_numbers, format);
+    }
+    else if (output) {
+        cerr << "Error: option -o needs a binary job file, see calc-convert\n";
+        return 1;
+    }
+    vector<calc::diagnostic> errors;
+    {
+        calc::output_buffer out{ fileno(stdout) };
+        if (threads == 1) {
+            calc::run_jobs(input.view(), true, out, errors, format);
+        }
+        else {
+            work_pool pool{ threads };
+            calc::run_parallel(input.view(), pool, out, errors, format);
+        }
+    }
+    calc::error_reporter reporter{ input.view(), line_numbers ? argv[i] : nullptr };
+    for (const auto& error : errors) {
+        reporter.report(error);
+    }
+}
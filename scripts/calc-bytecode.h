@@ -0,0 +1,336 @@
+// calc-bytecode.h : compile arithmetic expressions with variables to register bytecode, and run it
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include "calc-engine.h"
+
+namespace calc::bytecode {
+
+enum class opcode : std::uint8_t { add, subtract, multiply, divide, power, negate };
+
+// Every instruction reads registers a (and b, except for negate) and writes
+// register dst, so that it carries out one operation with no loads or stores
+struct instruction {
+    opcode op;
+    std::uint8_t dst, a, b;
+};
+static_assert(sizeof(instruction) == 4);
+
+constexpr std::size_t max_registers = 256, max_variables = 65536;
+
+// Parentheses and unary minus nest by recursion, which this keeps well within
+// the stack
+constexpr std::size_t max_nesting = 1000;
+
+// Temporaries are numbered upwards from register 0, while each distinct
+// constant and variable used has a register of its own numbered downwards
+// from the top, filled in before the code is run. The value is left in
+// register result (for an expression such as "x" there is no code at all).
+struct program {
+    std::vector<instruction> code;
+    std::vector<std::pair<std::uint8_t, double>> constants;
+    std::vector<std::pair<std::uint8_t, std::uint16_t>> variables;
+    std::uint8_t result{};
+};
+
+// Variables keep the slot they are first given, so compiled programs which
+// refer to them stay valid as others are added
+class symbol_table {
+public:
+    const std::uint16_t *find(std::string_view name) const {
+        auto iter = slots.find(name);
+        return (iter != slots.end()) ? &iter->second : nullptr;
+    }
+    bool assign(std::string_view name, double value) {
+        auto slot = find(name);
+        if (!slot) {
+            if (values.size() == max_variables) {
+                return false;
+            }
+            slot = &slots.emplace(std::string{ name }, static_cast<std::uint16_t>(values.size())).first->second;
+            values.push_back(value);
+        }
+        values[*slot] = value;
+        return true;
+    }
+    const double *data() const { return values.data(); }
+private:
+    struct hash : std::hash<std::string_view> {
+        using is_transparent = void;
+    };
+    std::unordered_map<std::string, std::uint16_t, hash, std::equal_to<>> slots;
+    std::vector<double> values;
+};
+
+inline bool is_identifier_start(char c) {
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_');
+}
+
+inline bool is_identifier(char c) {
+    return is_identifier_start(c) || ((c >= '0') && (c <= '9'));
+}
+
+// A single-pass recursive descent parser which emits code as it goes, without
+// building a tree: each rule is given the lowest free temporary register and
+// returns the register holding its value, which is either that one or the
+// register of a constant or variable. Precedence, lowest first, is + and -,
+// then * and /, then unary minus, then ^ (which groups to the right, so that
+// -2^2 is -4 and 2^3^2 is 512), then numbers, variables and parentheses.
+class compiler {
+public:
+    compiler(std::string_view text, const symbol_table& variables) : text{ text }, variables{ variables } {}
+
+    // On failure, error describes the first problem found
+    bool compile(program& out, std::string& error) {
+        p = text.data();
+        end = p + text.size();
+        code = &out;
+        out.code.clear();
+        out.constants.clear();
+        out.variables.clear();
+        temporaries = 0;
+        loads = max_registers;
+        depth = 0;
+        problem.clear();
+        std::size_t result;
+        if (sum(0, result) && (skip_space() == end)) {
+            out.result = static_cast<std::uint8_t>(result);
+            return true;
+        }
+        error = problem.empty() ? "unexpected '" + std::string(1, *p) + "'" : problem;
+        return false;
+    }
+
+private:
+    const char *skip_space() {
+        p = calc::skip_space(p, end);
+        return p;
+    }
+
+    bool fail(std::string message) {
+        if (problem.empty()) {
+            problem = std::move(message);
+        }
+        return false;
+    }
+
+    bool emit(opcode op, std::size_t dst, std::size_t a, std::size_t b) {
+        temporaries = std::max(temporaries, dst + 1);
+        if (temporaries > loads) {
+            return fail("expression too complex");
+        }
+        code->code.push_back({ op, static_cast<std::uint8_t>(dst), static_cast<std::uint8_t>(a), static_cast<std::uint8_t>(b) });
+        return true;
+    }
+
+    // The register for a constant or variable, shared by every use of it
+    template<typename T>
+    bool load(std::vector<std::pair<std::uint8_t, T>>& list, T value, std::size_t& reg) {
+        for (auto [r, v] : list) {
+            if (v == value) {
+                reg = r;
+                return true;
+            }
+        }
+        if (temporaries == loads) {
+            return fail("expression too complex");
+        }
+        reg = --loads;
+        list.emplace_back(static_cast<std::uint8_t>(reg), value);
+        return true;
+    }
+
+    bool sum(std::size_t r, std::size_t& result) {
+        if (!product(r, result)) {
+            return false;
+        }
+        while ((skip_space() != end) && ((*p == '+') || (*p == '-'))) {
+            auto op = (*p++ == '+') ? opcode::add : opcode::subtract;
+            std::size_t right;
+            if (!product(r + 1, right) || !emit(op, r, result, right)) {
+                return false;
+            }
+            result = r;
+        }
+        return true;
+    }
+
+    bool product(std::size_t r, std::size_t& result) {
+        if (!unary(r, result)) {
+            return false;
+        }
+        while ((skip_space() != end) && ((*p == '*') || (*p == '/'))) {
+            auto op = (*p++ == '*') ? opcode::multiply : opcode::divide;
+            std::size_t right;
+            if (!unary(r + 1, right) || !emit(op, r, result, right)) {
+                return false;
+            }
+            result = r;
+        }
+        return true;
+    }
+
+    // Every '(' and unary minus comes through here, so depth counts both
+    bool unary(std::size_t r, std::size_t& result) {
+        if (depth == max_nesting) {
+            return fail("expression too complex");
+        }
+        ++depth;
+        bool ok;
+        if ((skip_space() != end) && (*p == '-')) {
+            ++p;
+            std::size_t operand;
+            result = r;
+            ok = unary(r, operand) && emit(opcode::negate, r, operand, 0);
+        }
+        else {
+            ok = power(r, result);
+        }
+        --depth;
+        return ok;
+    }
+
+    bool power(std::size_t r, std::size_t& result) {
+        if (!primary(r, result)) {
+            return false;
+        }
+        if ((skip_space() != end) && (*p == '^')) {
+            ++p;
+            std::size_t right;
+            if (!unary(r + 1, right) || !emit(opcode::power, r, result, right)) {
+                return false;
+            }
+            result = r;
+        }
+        return true;
+    }
+
+    bool primary(std::size_t r, std::size_t& result) {
+        if (skip_space() == end) {
+            return fail("unexpected end of expression");
+        }
+        if (*p == '(') {
+            ++p;
+            if (!sum(r, result)) {
+                return false;
+            }
+            if ((skip_space() == end) || (*p != ')')) {
+                return fail("missing ')'");
+            }
+            ++p;
+            return true;
+        }
+        if (is_identifier_start(*p)) {
+            auto start = p;
+            while ((p != end) && is_identifier(*p)) {
+                ++p;
+            }
+            std::string_view name{ start, static_cast<std::size_t>(p - start) };
+            auto slot = variables.find(name);
+            if (!slot) {
+                return fail("undefined variable " + std::string{ name });
+            }
+            return load(code->variables, *slot, result);
+        }
+        double value;
+        if (((*p >= '0') && (*p <= '9')) || (*p == '.')) {
+            if (!parse_number(p, end, value)) {
+                return fail("bad number");
+            }
+            return load(code->constants, value, result);
+        }
+        return fail("unexpected '" + std::string(1, *p) + "'");
+    }
+
+    std::string_view text;
+    const symbol_table& variables;
+    const char *p{}, *end{};
+    program *code{};
+    std::size_t temporaries{}, loads{}, depth{};
+    std::string problem;
+};
+
+// One switch per instruction over a flat array of registers; as with calc()
+// in 08-calc.cpp, dividing by zero gives zero and an error status
+inline double run(const program& prog, const double *variables, status& s) {
+    double reg[max_registers];
+    for (auto [r, value] : prog.constants) {
+        reg[r] = value;
+    }
+    for (auto [r, slot] : prog.variables) {
+        reg[r] = variables[slot];
+    }
+    s = status::ok;
+    for (auto in : prog.code) {
+        switch (in.op) {
+        case opcode::add:
+            reg[in.dst] = reg[in.a] + reg[in.b];
+            break;
+        case opcode::subtract:
+            reg[in.dst] = reg[in.a] - reg[in.b];
+            break;
+        case opcode::multiply:
+            reg[in.dst] = reg[in.a] * reg[in.b];
+            break;
+        case opcode::divide:
+            if (reg[in.b] != 0) {
+                reg[in.dst] = reg[in.a] / reg[in.b];
+            }
+            else {
+                reg[in.dst] = 0;
+                s = status::divide_by_zero;
+            }
+            break;
+        case opcode::power:
+            reg[in.dst] = std::pow(reg[in.a], reg[in.b]);
+            break;
+        case opcode::negate:
+            reg[in.dst] = -reg[in.a];
+            break;
+        }
+    }
+    return reg[prog.result];
+}
+
+// Compiled programs keyed on the text of the expression, so that formulas
+// which recur are only compiled once; it is emptied if it grows too large
+class program_cache {
+public:
+    explicit program_cache(std::size_t capacity = 1 << 16) : capacity{ capacity } {}
+
+    const program *get(std::string_view text, const symbol_table& variables, std::string& error) {
+        if (auto iter = programs.find(text); iter != programs.end()) {
+            ++hit_count;
+            return &iter->second;
+        }
+        program compiled;
+        if (!compiler{ text, variables }.compile(compiled, error)) {
+            return nullptr;
+        }
+        ++miss_count;
+        if (programs.size() == capacity) {
+            programs.clear();
+        }
+        return &programs.emplace(std::string{ text }, std::move(compiled)).first->second;
+    }
+    std::size_t hits() const { return hit_count; }
+    std::size_t misses() const { return miss_count; }
+private:
+    struct hash : std::hash<std::string_view> {
+        using is_transparent = void;
+    };
+    std::unordered_map<std::string, program, hash, std::equal_to<>> programs;
+    std::size_t capacity, hit_count{}, miss_count{};
+};
+
+} // namespace calc::bytecode
@@ -0,0 +1,127 @@
+// calc-columnar.h : a binary file format holding 08-calc jobs, and their results, as columns
+
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include "calc-engine.h"
+#include "work-pool.h"
+
+namespace calc::columnar {
+
+// A 64-byte header is followed by each column in turn, all starting on a
+// 64-byte boundary: x and y as doubles and op as chars, then (for a results
+// file) r as doubles and the status of each row as a byte. Numbers are stored
+// in the writer's byte order, which byte_order allows a reader to check.
+struct header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t rows;
+    std::uint64_t x, y, op, r, error;   // offsets from the start of the file
+};
+static_assert(sizeof(header) == 64);
+
+constexpr char jobs_magic[8]{ 'C', 'A', 'L', 'C', 'J', 'O', 'B', 'S' };
+constexpr char results_magic[8]{ 'C', 'A', 'L', 'C', 'R', 'S', 'L', 'T' };
+constexpr std::uint32_t format_version = 1, native_order = 0x01020304;
+
+inline std::uint64_t align(std::uint64_t offset) {
+    return (offset + 63) & ~std::uint64_t{ 63 };
+}
+
+// The header of a file holding the given number of rows, which fixes its layout
+inline header make_header(std::uint64_t rows, bool results) {
+    header h{};
+    std::memcpy(h.magic, results ? results_magic : jobs_magic, sizeof(h.magic));
+    h.version = format_version;
+    h.byte_order = native_order;
+    h.rows = rows;
+    h.x = sizeof(header);
+    h.y = align(h.x + rows * sizeof(double));
+    h.op = align(h.y + rows * sizeof(double));
+    if (results) {
+        h.r = align(h.op + rows);
+        h.error = align(h.r + rows * sizeof(double));
+    }
+    return h;
+}
+
+inline std::uint64_t file_size(const header& h) {
+    return h.error ? (h.error + h.rows) : (h.op + h.rows);
+}
+
+inline bool is_columnar(std::string_view file) {
+    return file.starts_with(std::string_view{ jobs_magic, 8 }) || file.starts_with(std::string_view{ results_magic, 8 });
+}
+
+// The columns of a mapped jobs or results file (r and error are null for a
+// jobs file); the mapping must outlive it
+struct columns {
+    std::uint64_t rows{};
+    const double *x{}, *y{}, *r{};
+    const char *op{};
+    const status *error{};
+};
+
+// Fails unless the file is complete and laid out exactly as make_header() gives
+inline bool open_columns(std::string_view file, columns& c) {
+    header h;
+    if (!is_columnar(file) || (file.size() < sizeof(h))) {
+        return false;
+    }
+    std::memcpy(&h, file.data(), sizeof(h));
+    auto results = std::string_view{ h.magic, 8 } == std::string_view{ results_magic, 8 };
+    auto expected = make_header(h.rows, results);
+    if ((std::memcmp(&h, &expected, sizeof(h)) != 0) || (file_size(h) != file.size())) {
+        return false;
+    }
+    auto base = file.data();
+    c.rows = h.rows;
+    c.x = reinterpret_cast<const double*>(base + h.x);
+    c.y = reinterpret_cast<const double*>(base + h.y);
+    c.op = base + h.op;
+    c.r = results ? reinterpret_cast<const double*>(base + h.r) : nullptr;
+    c.error = results ? reinterpret_cast<const status*>(base + h.error) : nullptr;
+    return true;
+}
+
+struct writable_columns {
+    double *x, *y, *r;
+    char *op;
+    status *error;
+};
+
+// Writes the header to out, which must hold file_size(h) bytes, and gives
+// where each column goes (r and error are null for a jobs file)
+inline writable_columns lay_out(char *out, const header& h) {
+    std::memcpy(out, &h, sizeof(h));
+    return { reinterpret_cast<double*>(out + h.x), reinterpret_cast<double*>(out + h.y),
+        h.r ? reinterpret_cast<double*>(out + h.r) : nullptr, out + h.op,
+        h.error ? reinterpret_cast<status*>(out + h.error) : nullptr };
+}
+
+// Evaluates every row of a jobs file straight from (and into) the mapped
+// columns, in ranges of rows shared between the pool's threads
+inline void evaluate_file(const columns& jobs, writable_columns& out, work_pool& pool) {
+    std::memcpy(out.x, jobs.x, jobs.rows * sizeof(double));
+    std::memcpy(out.y, jobs.y, jobs.rows * sizeof(double));
+    std::memcpy(out.op, jobs.op, jobs.rows);
+    constexpr std::uint64_t range = 1 << 16;
+    for (std::uint64_t first = 0; first < jobs.rows; first += range) {
+        pool.submit([&, first] {
+            column_scratch scratch;
+            auto last = std::min(first + range, jobs.rows);
+            for (auto row = first; row < last; row += block_size) {
+                auto n = std::min<std::uint64_t>(block_size, last - row);
+                evaluate_columns(n, jobs.x + row, jobs.y + row, jobs.op + row, out.r + row, out.error + row, scratch);
+            }
+        });
+    }
+    pool.wait();
+}
+
+} // namespace calc::columnar
@@ -0,0 +1,104 @@
+// calc-convert.cpp : convert 08-calc job files between text and the binary columnar format
+
+#include <string_view>
+#include <vector>
+#include <iostream>
+#include <charconv>
+#include <cstdio>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "mapped-file.h"
+#include "calc-engine.h"
+#include "calc-columnar.h"
+using namespace std;
+
+// Every job up to the first malformed one (if any) is converted; trailing
+// whitespace is not an error here, unlike for 08-calc itself
+int text_to_jobs(string_view text, const char *input, const char *output) {
+    vector<double> x, y;
+    vector<char> op;
+    auto begin = text.data(), p = begin, end = begin + text.size();
+    calc::job j;
+    int status{};
+    while (calc::skip_space(p, end) != end) {
+        if (calc::parse_job(p, end, j) != calc::parsed::ok) {
+            calc::error_reporter reporter{ text, input };
+            reporter.report({ static_cast<size_t>(calc::skip_space(p, end) - begin), calc::status::bad_input });
+            status = 1;
+            break;
+        }
+        x.push_back(j.x);
+        y.push_back(j.y);
+        op.push_back(j.op);
+    }
+    auto h = calc::columnar::make_header(op.size(), false);
+    mapped_output out{ output, calc::columnar::file_size(h) };
+    if (!out) {
+        cerr << "Error creating file: " << output << '\n';
+        return 1;
+    }
+    auto columns = calc::columnar::lay_out(out.begin(), h);
+    copy(x.begin(), x.end(), columns.x);
+    copy(y.begin(), y.end(), columns.y);
+    copy(op.begin(), op.end(), columns.op);
+    cout << op.size() << " jobs written to " << output << '\n';
+    return status;
+}
+
+// Jobs are written with the shortest digits which read back as the same
+// value; results as 08-calc prints them, with its messages for any errors
+int columns_to_text(const calc::columnar::columns& c, const char *output) {
+    int fd = ::open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        cerr << "Error creating file: " << output << '\n';
+        return 1;
+    }
+    {
+        calc::output_buffer out{ fd };
+        for (uint64_t row = 0; row != c.rows; ++row) {
+            if (c.r) {
+                out.commit(calc::format_line(out.reserve(calc::max_line_length), { c.x[row], c.y[row], c.op[row] }, c.r[row]));
+                fputs(calc::message(c.error[row]), stderr);
+            }
+            else {
+                auto p = out.reserve(calc::max_line_length);
+                p = calc::format_number(p, c.x[row], calc::output_format::round_trip);
+                *p++ = ' ';
+                *p++ = c.op[row];
+                *p++ = ' ';
+                p = calc::format_number(p, c.y[row], calc::output_format::round_trip);
+                *p++ = '\n';
+                out.commit(p);
+            }
+        }
+    }
+    ::close(fd);
+    cout << c.rows << (c.r ? " results" : " jobs") << " written to " << output << '\n';
+    return 0;
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc != 3) {
+        cerr << "Syntax: " << argv[0] << " <input file> <output file>\n"
+            << "Text job files are converted to binary, binary job or result files to text\n";
+        return 1;
+    }
+    mapped_file input{ argv[1] };
+    if (!input) {
+        cerr << "Error opening file: " << argv[1] << '\n';
+        return 1;
+    }
+    if (!calc::columnar::is_columnar(input.view())) {
+        return text_to_jobs(input.view(), argv[1], argv[2]);
+    }
+    calc::columnar::columns c;
+    if (!calc::columnar::open_columns(input.view(), c)) {
+        cerr << "Error: incomplete or invalid binary file: " << argv[1] << '\n';
+        return 1;
+    }
+    return columns_to_text(c, argv[2]);
+}
@@ -0,0 +1,464 @@
+// calc-engine.h : the calculations of 08-calc.cpp over a whole input file, without iostreams
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include "work-pool.h"
+#include "bigint.h"
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace calc {
+
+struct job {
+    double x, y;
+    char op;
+};
+
+enum class status : unsigned char { ok, divide_by_zero, invalid_op, bad_input };
+
+// As calc() in 08-calc.cpp, which returns zero after an error
+inline double evaluate(const job& j, status& s) {
+    s = status::ok;
+    switch (j.op) {
+    case '+':
+        return j.x + j.y;
+    case '-':
+        return j.x - j.y;
+    case '*':
+        return j.x * j.y;
+    case '/':
+        if (j.y) {
+            return j.x / j.y;
+        }
+        s = status::divide_by_zero;
+        return 0;
+    case '^':
+        return std::pow(j.x, j.y);
+    default:
+        s = status::invalid_op;
+        return 0;
+    }
+}
+
+inline const char *message(status s) {
+    return (s == status::divide_by_zero) ? "Error: divide by zero.\n"
+        : (s == status::invalid_op) ? "Error: invalid op.\n"
+        : (s == status::bad_input) ? "Error in input.\n" : "";
+}
+
+// Working space for evaluate_columns(), reused between calls
+struct column_scratch {
+    std::vector<std::uint32_t> powers;      // row numbers with '^'
+
+    void reserve(std::size_t n) {
+        if (powers.size() < n) {
+            powers.resize(n);
+        }
+    }
+};
+
+// Evaluates every row in place with no branches: each of +, -, * and / is
+// worked out and the one wanted is blended in with a mask made from the
+// operator, with division by zero and unknown operators handled by the same
+// masks, giving the same results as evaluate(). This is written so that GCC
+// can vectorize it: the divisor is y + (y == 0), not a select, which it would
+// turn back into a branch, and the operators are checked with a sum of
+// comparisons, not ||, which it would turn into a 64-bit bit test. The
+// attribute asks for the cost model -O3 uses, as at -O2 GCC 12 only
+// vectorizes loops which need no scalar loop for the remainder, so this one
+// is vectorized at -O2 as well. Rows with '^' are picked out beforehand and go
+// to std::pow() afterwards, as GCC only vectorizes it (using glibc's vector
+// math library, which is not always correctly rounded) when compiled with
+// -ffast-math.
+#if defined(__GNUC__) && !defined(__clang__)
+__attribute__((optimize("tree-vectorize", "vect-cost-model=dynamic")))
+#endif
+inline void evaluate_columns(std::size_t n, const double *__restrict column_x, const double *__restrict column_y,
+    const char *__restrict column_op, double *__restrict column_r, status *__restrict column_error,
+    column_scratch& scratch) {
+    scratch.reserve(n);
+    auto powers = scratch.powers.data();
+    std::size_t count{};
+    for (std::size_t i = 0; i != n; ++i) {
+        powers[count] = static_cast<std::uint32_t>(i);
+        count += (column_op[i] == '^');
+    }
+    auto mask = [](bool b) { return 0 - static_cast<std::uint64_t>(b); };
+    auto bits = [](double d) { return std::bit_cast<std::uint64_t>(d); };
+    for (std::size_t i = 0; i != n; ++i) {
+        auto op = column_op[i];
+        auto x = column_x[i], y = column_y[i];
+        auto r = (bits(x + y) & mask(op == '+')) | (bits(x - y) & mask(op == '-'))
+            | (bits(x * y) & mask(op == '*')) | (bits(x / (y + (y == 0))) & mask((op == '/') & (y != 0)));
+        column_r[i] = std::bit_cast<double>(r);
+        auto known = (op == '+') + (op == '-') + (op == '*') + (op == '/') + (op == '^');
+        column_error[i] = static_cast<status>(((op == '/') & (y == 0)) * static_cast<int>(status::divide_by_zero)
+            + (known == 0) * static_cast<int>(status::invalid_op));
+    }
+    for (std::size_t k = 0; k != count; ++k) {
+        auto i = powers[k];
+        column_r[i] = std::pow(column_x[i], column_y[i]);
+    }
+}
+
+// Rows of jobs parsed from text, held as separate columns
+struct job_columns {
+    std::vector<double> x, y, r;
+    std::vector<char> op;
+    std::vector<status> error;
+    std::vector<std::size_t> offset;        // of each job in the input, for error messages
+    column_scratch scratch;
+    std::size_t size{};
+
+    void resize(std::size_t n) {
+        x.resize(n);
+        y.resize(n);
+        r.resize(n);
+        op.resize(n);
+        error.resize(n);
+        offset.resize(n);
+        scratch.reserve(n);
+        size = n;
+    }
+};
+
+inline void evaluate_columns(job_columns& c) {
+    evaluate_columns(c.size, c.x.data(), c.y.data(), c.op.data(), c.r.data(), c.error.data(), c.scratch);
+}
+
+inline bool is_space(char c) {
+    return (c == ' ') || ((c >= '\t') && (c <= '\r'));
+}
+
+inline const char *skip_space(const char *p, const char *end) {
+    while ((p != end) && is_space(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+// Reads a number as "infile >> x" does in the "C" locale: unlike from_chars, a
+// leading '+' is allowed and "inf", "nan" and an incomplete exponent are not;
+// numbers too small for a double become zero (or denormal) rather than failing
+inline bool parse_number(const char *& p, const char *end, double& value) {
+    auto first = skip_space(p, end);
+    auto start = first + ((first != end) && (*first == '+'));
+    auto digit = start + ((start == first) && (start != end) && (*start == '-'));
+    if ((digit == end) || !(((*digit >= '0') && (*digit <= '9')) || (*digit == '.'))) {
+        return false;
+    }
+    auto [next, ec] = std::from_chars(start, end, value);
+    if (ec == std::errc::result_out_of_range) {
+        std::string token{ start, next };
+        value = std::strtod(token.c_str(), nullptr);
+        ec = std::isinf(value) ? ec : std::errc{};
+    }
+    // An 'e' straight after a number with no exponent of its own starts an
+    // incomplete one, which fails; after a complete exponent it is left unread
+    auto exponent = std::find_if(start, next, [](char c) { return (c == 'e') || (c == 'E'); });
+    if ((ec != std::errc{}) || ((exponent == next) && (next != end) && ((*next == 'e') || (*next == 'E')))) {
+        return false;
+    }
+    p = next;
+    return true;
+}
+
+enum class parsed { ok, bad, incomplete };
+
+// Equivalent to "infile >> x >> op >> y"; on failure p is left unchanged, and
+// the result is incomplete if the text ran out part way through
+inline parsed parse_job(const char *& p, const char *end, job& j) {
+    auto q = p;
+    if (!parse_number(q, end, j.x)) {
+        return (skip_space(q, end) == end) ? parsed::incomplete : parsed::bad;
+    }
+    q = skip_space(q, end);
+    if (q == end) {
+        return parsed::incomplete;
+    }
+    j.op = *q++;
+    if (!parse_number(q, end, j.y)) {
+        return (skip_space(q, end) == end) ? parsed::incomplete : parsed::bad;
+    }
+    p = q;
+    return parsed::ok;
+}
+
+// Numbers are written either as cout does with its default precision of 6,
+// which is what to_chars gives for chars_format::general, or with the fewest
+// digits which read back as exactly the same value (at most 24 characters).
+// With exact_powers, numbers are written as for cout except for the results
+// of '^', see format_exact_power().
+enum class output_format { cout, round_trip, exact_powers };
+
+constexpr std::size_t max_line_length = 80;
+
+inline char *format_number(char *out, double value, output_format f) {
+    return (f != output_format::round_trip) ? std::to_chars(out, out + 24, value, std::chars_format::general, 6).ptr
+        : std::to_chars(out, out + 24, value).ptr;
+}
+
+// Writes "x op y = r\n", returning the new end
+inline char *format_line(char *out, const job& j, double r, output_format f = output_format::cout) {
+    out = format_number(out, j.x, f);
+    *out++ = ' ';
+    *out++ = j.op;
+    *out++ = ' ';
+    out = format_number(out, j.y, f);
+    *out++ = ' ';
+    *out++ = '=';
+    *out++ = ' ';
+    out = format_number(out, r, f);
+    *out++ = '\n';
+    return out;
+}
+
+// Collects output in a large block which is written out whenever it fills up;
+// with a file descriptor of -1 it grows instead, keeping everything in memory
+class output_buffer {
+public:
+    explicit output_buffer(int fd, std::size_t capacity = 1 << 20) : fd{ fd }, buffer(capacity, '\0') {}
+    ~output_buffer() { flush(); }
+    output_buffer(const output_buffer&) = delete;
+    output_buffer& operator=(const output_buffer&) = delete;
+
+    char *reserve(std::size_t n) {
+        if (buffer.size() - used < n) {
+            flush();
+            if (buffer.size() - used < n) {
+                buffer.resize(std::max(buffer.size() * 2, used + n));
+            }
+        }
+        return buffer.data() + used;
+    }
+    void commit(const char *end) { used = end - buffer.data(); }
+    void append(std::string_view text) {
+        if ((fd != -1) && (text.size() >= buffer.size())) {
+            flush();
+            write_all(text);
+            return;
+        }
+        auto out = reserve(text.size());
+        std::copy(text.begin(), text.end(), out);
+        commit(out + text.size());
+    }
+    std::string_view view() const { return { buffer.data(), used }; }
+    bool flush() {
+        if (fd == -1) {
+            return true;
+        }
+        bool ok = write_all(view());
+        used = 0;
+        return ok;
+    }
+private:
+    bool write_all(std::string_view text) {
+        for (std::size_t written{}; written != text.size(); ) {
+            auto n = ::write(fd, text.data() + written, static_cast<unsigned>(text.size() - written));
+            if (n <= 0) {
+                return false;
+            }
+            written += n;
+        }
+        return true;
+    }
+
+    int fd;
+    std::string buffer;
+    std::size_t used{};
+};
+
+// The result of a whole number raised to a whole, non-negative power is
+// written out with every digit, worked out with big_integer (for results of up to
+// max_exact_bits); returns false for any other calculation, which is left to
+// format_line(). The conversion to decimal is quadratic, so the limit keeps
+// each line to about a fifth of a second (some 79,000 digits).
+constexpr std::size_t max_exact_bits = 1 << 18;
+
+inline bool format_exact_power(output_buffer& out, double x, double y) {
+    if (!std::isfinite(x) || (std::trunc(x) != x) || (std::trunc(y) != y) || !(y >= 0) || (y > 0x1p53)) {
+        return false;
+    }
+    auto base = big_integer::from_double(x);
+    auto exponent = static_cast<std::uint64_t>(y);
+    if (exponent && (base.bits() > max_exact_bits / exponent)) {
+        return false;
+    }
+    // The operands are written as for any other line
+    auto p = out.reserve(max_line_length);
+    p = format_number(p, x, output_format::cout);
+    p = std::copy_n(" ^ ", 3, p);
+    p = format_number(p, y, output_format::cout);
+    p = std::copy_n(" = ", 3, p);
+    out.commit(p);
+    out.append(pow(base, exponent).to_string());
+    out.append("\n");
+    return true;
+}
+
+// Errors are kept with their offset in the input so that they can be reported
+// in order, with line numbers, after the output has been produced
+struct diagnostic {
+    std::size_t offset;
+    status error;
+};
+
+struct run_result {
+    std::size_t consumed, jobs;
+    bool stopped;       // on malformed input, as 08-calc's loop does
+};
+
+// Evaluates the jobs in text, appending one line each to out; they are parsed
+// into columns and evaluated a block at a time. Only the final part of a file
+// reports trailing whitespace as bad input (08-calc.cpp loops until
+// end-of-file, so an input ending with a newline finishes with "Error in
+// input.", as does an empty file); for any other part, consumed gives where
+// the unfinished job starts.
+constexpr std::size_t block_size = 1024;
+
+inline run_result run_jobs(std::string_view text, bool final, output_buffer& out, std::vector<diagnostic>& errors,
+    output_format f = output_format::cout) {
+    auto begin = text.data(), p = begin, end = begin + text.size();
+    std::size_t count{};
+    job_columns columns;
+    columns.resize(block_size);
+    job j;
+    auto at_end = !final && (p == end);
+    auto result = parsed::ok;
+    while (!at_end && (result == parsed::ok)) {
+        std::size_t n{};
+        while ((n != block_size) && !at_end) {
+            auto start = p;
+            result = parse_job(p, end, j);
+            if (result != parsed::ok) {
+                break;
+            }
+            columns.x[n] = j.x;
+            columns.y[n] = j.y;
+            columns.op[n] = j.op;
+            columns.offset[n++] = start - begin;
+            at_end = p == end;
+        }
+        columns.size = n;
+        evaluate_columns(columns);
+        for (std::size_t i = 0; i != n; ++i) {
+            if (columns.error[i] != status::ok) {
+                errors.push_back({ static_cast<std::size_t>(skip_space(begin + columns.offset[i], end) - begin), columns.error[i] });
+            }
+            if ((f != output_format::exact_powers) || (columns.op[i] != '^') || !format_exact_power(out, columns.x[i], columns.y[i])) {
+                out.commit(format_line(out.reserve(max_line_length), { columns.x[i], columns.y[i], columns.op[i] }, columns.r[i], f));
+            }
+        }
+        count += n;
+    }
+    if (result == parsed::ok) {
+        return { text.size(), count, false };
+    }
+    if (!final && (result == parsed::incomplete)) {
+        return { static_cast<std::size_t>(p - begin), count, false };
+    }
+    errors.push_back({ static_cast<std::size_t>(skip_space(p, end) - begin), status::bad_input });
+    return { static_cast<std::size_t>(p - begin), count, true };
+}
+
+// Splits text after newlines into parts of about chunk_size bytes which are
+// evaluated on the pool's threads, a round of twice as many parts as threads at
+// a time so that memory use stays bounded, with each round's output written out
+// in order. As 08-calc reads tokens rather than lines, a job may continue into
+// the next part; that part is then evaluated again from the start of the job,
+// after which the parts which follow line up again.
+inline void run_parallel(std::string_view text, work_pool& pool, output_buffer& out,
+    std::vector<diagnostic>& errors, output_format f = output_format::cout, std::size_t chunk_size = 4 << 20) {
+    std::vector<std::size_t> bounds{ 0 };
+    while (bounds.back() != text.size()) {
+        auto newline = text.find('\n', std::min(bounds.back() + chunk_size, text.size()) - 1);
+        bounds.push_back((newline == std::string_view::npos) ? text.size() : newline + 1);
+    }
+    auto parts = bounds.size() - 1;
+    if (parts <= 1) {
+        run_jobs(text, true, out, errors, f);
+        return;
+    }
+
+    struct part {
+        output_buffer out{ -1, 0 };
+        std::vector<diagnostic> errors;
+        run_result result{};
+    };
+    std::size_t resume{};
+    auto emit = [&](std::size_t begin, std::size_t end, const part& p) {
+        out.append(p.out.view());
+        for (auto error : p.errors) {
+            error.offset += begin;
+            errors.push_back(error);
+        }
+        auto next = text.data() + begin + p.result.consumed;
+        resume = (skip_space(next, text.data() + end) == text.data() + end) ? end : next - text.data();
+        return p.result.stopped;
+    };
+    for (std::size_t first = 0, round = pool.size() * 2; first < parts; first += round) {
+        auto last = std::min(first + round, parts);
+        std::vector<part> results(last - first);
+        for (auto i = first; i != last; ++i) {
+            pool.submit([&, i] {
+                auto& p = results[i - first];
+                p.out.reserve((bounds[i + 1] - bounds[i]) * 2);
+                p.result = run_jobs(text.substr(bounds[i], bounds[i + 1] - bounds[i]), i + 1 == parts, p.out, p.errors, f);
+            });
+        }
+        pool.wait();
+        for (auto i = first; i != last; ++i) {
+            bool stopped;
+            if (resume == bounds[i]) {
+                stopped = emit(bounds[i], bounds[i + 1], results[i - first]);
+            }
+            else {
+                part redo;
+                redo.result = run_jobs(text.substr(resume, bounds[i + 1] - resume), i + 1 == parts, redo.out, redo.errors, f);
+                stopped = emit(resume, bounds[i + 1], redo);
+            }
+            if (stopped) {
+                return;
+            }
+        }
+    }
+}
+
+// Writes the messages of 08-calc.cpp to standard error, optionally prefixed
+// with "filename:line: "; the offsets passed must not decrease
+class error_reporter {
+public:
+    error_reporter(std::string_view text, const char *filename) : text{ text }, filename{ filename } {}
+    void report(const diagnostic& d) {
+        if (filename) {
+            for (; counted < d.offset; ++counted) {
+                line += text[counted] == '\n';
+            }
+            std::fprintf(stderr, "%s:%zu: %s", filename, line, message(d.error));
+        }
+        else {
+            std::fputs(message(d.error), stderr);
+        }
+    }
+private:
+    std::string_view text;
+    const char *filename;
+    std::size_t line{ 1 }, counted{};
+};
+
+} // namespace calc
@@ -0,0 +1,106 @@
+// calc-expr.cpp : evaluate a file of arithmetic expressions and variable assignments
+
+#include <string>
+#include <string_view>
+#include <iostream>
+#include <cstdio>
+#include "mapped-file.h"
+#include "calc-engine.h"
+#include "calc-bytecode.h"
+using namespace std;
+
+// Each line is either an expression, printed followed by " = " and its value,
+// or an assignment "name = expression", printed as "name = value"; blank lines
+// and those starting with '#' are skipped. Results are formatted as 08-calc
+// does. A line with an error is reported and skipped, as is an assignment
+// which divides by zero (so the variable keeps any previous value).
+int main(int argc, const char *argv[]) {
+    bool line_numbers{}, statistics{};
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-') && argv[i][1]; ++i) {
+        string_view option{ argv[i] };
+        if (option == "-l") {
+            line_numbers = true;
+        }
+        else if (option == "-s") {
+            statistics = true;
+        }
+        else {
+            break;
+        }
+    }
+    if (i + 1 != argc) {
+        cerr << "Syntax: " << argv[0] << " [-l] [-s] <input file name>\n";
+        return 1;
+    }
+    mapped_file input{ argv[i] };
+    if (!input) {
+        cerr << "Error opening file: " << argv[i] << '\n';
+        return 1;
+    }
+
+    calc::bytecode::symbol_table variables;
+    calc::bytecode::program_cache cache;
+    calc::output_buffer out{ fileno(stdout) };
+    line_reader lines{ input.view() };
+    string_view line;
+    string error;
+    size_t evaluated{};
+    auto report = [&](string_view message) {
+        out.flush();
+        if (line_numbers) {
+            cerr << argv[i] << ':' << lines.line_number() << ": ";
+        }
+        cerr << message << '\n';
+    };
+    while (lines.getline(line)) {
+        auto first = line.find_first_not_of(" \t"), last = line.find_last_not_of(" \t");
+        if ((first == string_view::npos) || (line[first] == '#')) {
+            continue;
+        }
+        line = line.substr(first, last - first + 1);
+        string_view target, expression{ line };
+        auto equals = line.find('=');
+        if (equals != string_view::npos) {
+            target = line.substr(0, line.find_last_not_of(" \t", equals - 1) + 1);
+            expression = line.substr(line.find_first_not_of(" \t", equals + 1) == string_view::npos
+                ? line.size() : line.find_first_not_of(" \t", equals + 1));
+            if (target.empty() || !calc::bytecode::is_identifier_start(target.front())
+                || (target.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != string_view::npos)) {
+                report("Error in input: bad variable name.");
+                continue;
+            }
+        }
+        auto program = cache.get(expression, variables, error);
+        if (!program) {
+            report("Error in input: " + error + '.');
+            continue;
+        }
+        calc::status s;
+        auto r = calc::bytecode::run(*program, variables.data(), s);
+        ++evaluated;
+        if (s != calc::status::ok) {
+            string_view message{ calc::message(s) };
+            report(message.substr(0, message.size() - 1));
+            if (!target.empty()) {
+                continue;
+            }
+        }
+        if (!target.empty() && !variables.assign(target, r)) {
+            report("Error: too many variables.");
+            continue;
+        }
+        auto text = target.empty() ? expression : target;
+        auto p = out.reserve(text.size() + calc::max_line_length);
+        p = copy(text.begin(), text.end(), p);
+        p = copy_n(" = ", 3, p);
+        p = to_chars(p, p + 16, r, chars_format::general, 6).ptr;
+        *p++ = '\n';
+        out.commit(p);
+    }
+    out.flush();
+    if (statistics) {
+        cerr << evaluated << " expressions evaluated, " << cache.misses() << " compiled, "
+            << cache.hits() << " found in the cache\n";
+    }
+}
@@ -0,0 +1,286 @@
+// calc-pipeline.cpp : 08-calc for streamed input, as parse, evaluate and format stages on separate threads
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include "calc-engine.h"
+#include "ring-buffer.h"
+using namespace std;
+
+// Rows travel between the stages in batches, which are recycled: the parser
+// takes an empty one from the free queue, fills it and passes it to one of the
+// evaluators in turn; all of the evaluators pass them on to the formatter,
+// which puts them back in order, writes them out and returns them to the
+// parser. The number of batches therefore bounds the memory used.
+constexpr size_t rows_per_batch = 4096, read_size = 1 << 20;
+
+struct row_batch {
+    uint64_t sequence{};
+    size_t size{};
+    double x[rows_per_batch], y[rows_per_batch], r[rows_per_batch];
+    char op[rows_per_batch];
+    calc::status error[rows_per_batch];
+    bool stopped{};         // after these rows, the input was malformed
+    bool last{};
+};
+
+using clock_type = chrono::steady_clock;
+
+// For each stage, the time spent working (including reading the input) rather
+// than waiting on a queue; for each queue, its length as seen by the producer
+// after each push
+struct stage_counters {
+    size_t rows{}, batches{};
+    clock_type::duration busy{};
+};
+
+struct queue_counters {
+    size_t pushes{}, total_depth{}, max_depth{};
+
+    void sample(size_t depth) {
+        ++pushes;
+        total_depth += depth;
+        max_depth = max(max_depth, depth);
+    }
+};
+
+class timer {
+public:
+    explicit timer(clock_type::duration& total) : total{ total }, start{ clock_type::now() } {}
+    ~timer() { total += clock_type::now() - start; }
+private:
+    clock_type::duration& total;
+    clock_type::time_point start;
+};
+
+// Reads tokens across read boundaries, as infile >> x >> op >> y does, so
+// that output (and error messages) are the same as from 08-calc.cpp: input
+// must end straight after a calculation, so that a final newline (or an
+// empty input) ends with "Error in input."
+class parser {
+public:
+    explicit parser(int fd) : fd{ fd } {}
+
+    // Fills b with as many rows as are available without waiting for more
+    // input (at least one), returning false once the input has ended
+    bool fill(row_batch& b) {
+        b.size = 0;
+        while (!finished && (b.size != rows_per_batch)) {
+            const char *p = buffer.data() + position, *end = buffer.data() + complete;
+            calc::job j;
+            auto result = calc::parse_job(p, end, j);
+            if ((result == calc::parsed::bad) || (eof && (result == calc::parsed::incomplete))) {
+                b.stopped = finished = true;
+                break;
+            }
+            if (result == calc::parsed::incomplete) {
+                if (b.size) {
+                    break;
+                }
+                read_more();
+                continue;
+            }
+            b.x[b.size] = j.x;
+            b.y[b.size] = j.y;
+            b.op[b.size++] = j.op;
+            position = p - buffer.data();
+            finished = eof && (p == end);
+        }
+        b.last = finished;
+        return !finished;
+    }
+
+private:
+    // Until the input ends, only text up to the last whitespace is parsed, as
+    // a token (such as "-" or "1e") which runs to the end of what has been
+    // read so far may continue in the next read
+    void read_more() {
+        buffer.erase(0, position);
+        position = 0;
+        auto old = buffer.size();
+        buffer.resize(old + read_size);
+        auto n = ::read(fd, buffer.data() + old, read_size);
+        buffer.resize(old + max<ssize_t>(n, 0));
+        eof = n <= 0;
+        complete = buffer.size();
+        while (!eof && complete && !calc::is_space(buffer[complete - 1])) {
+            --complete;
+        }
+    }
+
+    int fd;
+    string buffer;
+    size_t position{}, complete{};
+    bool eof{}, finished{};
+};
+
+int main(int argc, const char *argv[]) {
+    unsigned evaluators{ 2 };
+    bool statistics{};
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-') && argv[i][1]; ++i) {
+        string_view option{ argv[i] };
+        if ((option == "-j") && (i + 1 < argc)) {
+            evaluators = max(1, atoi(argv[++i]));
+        }
+        else if (option == "-s") {
+            statistics = true;
+        }
+        else {
+            break;
+        }
+    }
+    if (i + 1 < argc) {
+        cerr << "Syntax: " << argv[0] << " [-j evaluator threads] [-s] [input file name, or - or nothing for standard input]\n";
+        return 1;
+    }
+    // As with 08-calc, a file which cannot be opened reads as empty
+    int fd = 0;
+    if ((i < argc) && (string_view{ argv[i] } != "-")) {
+        fd = ::open(argv[i], O_RDONLY);
+    }
+
+    auto batch_count = 4 * (evaluators + 2);
+    size_t queue_size{ 1 };
+    while (queue_size < batch_count) {
+        queue_size *= 2;
+    }
+    vector<unique_ptr<row_batch>> batches;
+    spsc_ring<row_batch*> free_batches{ queue_size };
+    for (size_t b = 0; b != batch_count; ++b) {
+        batches.push_back(make_unique<row_batch>());
+        free_batches.push(batches.back().get());
+    }
+    vector<unique_ptr<spsc_ring<row_batch*>>> to_evaluate;
+    for (unsigned e = 0; e != evaluators; ++e) {
+        to_evaluate.push_back(make_unique<spsc_ring<row_batch*>>(queue_size));
+    }
+    mpsc_ring<row_batch*> to_format{ queue_size };
+
+    stage_counters parse_stage, format_stage;
+    vector<stage_counters> evaluate_stages(evaluators);
+    vector<queue_counters> evaluate_queues(evaluators), format_queues(evaluators);
+    auto start = clock_type::now();
+
+    thread parse_thread{ [&] {
+        parser input{ fd };
+        bool more = true;
+        for (uint64_t sequence = 0; more; ++sequence) {
+            auto b = free_batches.pop();
+            {
+                timer t{ parse_stage.busy };
+                b->sequence = sequence;
+                b->stopped = false;
+                more = input.fill(*b);
+            }
+            parse_stage.rows += b->size;
+            ++parse_stage.batches;
+            auto e = sequence % evaluators;
+            to_evaluate[e]->push(b);
+            evaluate_queues[e].sample(to_evaluate[e]->size());
+        }
+        for (auto& queue : to_evaluate) {
+            queue->push(nullptr);
+        }
+    } };
+
+    vector<thread> evaluate_threads;
+    for (unsigned e = 0; e != evaluators; ++e) {
+        evaluate_threads.emplace_back([&, e] {
+            calc::column_scratch scratch;
+            auto& counters = evaluate_stages[e];
+            while (auto b = to_evaluate[e]->pop()) {
+                {
+                    timer t{ counters.busy };
+                    calc::evaluate_columns(b->size, b->x, b->y, b->op, b->r, b->error, scratch);
+                }
+                counters.rows += b->size;
+                ++counters.batches;
+                to_format.push(b);
+                format_queues[e].sample(to_format.size());
+            }
+        });
+    }
+
+    {
+        calc::output_buffer out{ fileno(stdout) }, errors{ fileno(stderr), 1 << 16 };
+        vector<row_batch*> waiting(batch_count);
+        uint64_t next{};
+        for (bool done = false; !done; ) {
+            // Whatever is ready is written out before waiting for more
+            row_batch *b;
+            if (!to_format.try_pop(b)) {
+                out.flush();
+                errors.flush();
+                b = to_format.pop();
+            }
+            waiting[b->sequence % batch_count] = b;
+            while (!done && (b = waiting[next % batch_count]) && (b->sequence == next)) {
+                waiting[next++ % batch_count] = nullptr;
+                {
+                    timer t{ format_stage.busy };
+                    for (size_t row = 0; row != b->size; ++row) {
+                        if (b->error[row] != calc::status::ok) {
+                            errors.append(calc::message(b->error[row]));
+                        }
+                        out.commit(calc::format_line(out.reserve(calc::max_line_length), { b->x[row], b->y[row], b->op[row] }, b->r[row]));
+                    }
+                    if (b->stopped) {
+                        errors.append(calc::message(calc::status::bad_input));
+                    }
+                }
+                format_stage.rows += b->size;
+                ++format_stage.batches;
+                done = b->last;
+                free_batches.push(b);
+            }
+        }
+    }
+    parse_thread.join();
+    for (auto& t : evaluate_threads) {
+        t.join();
+    }
+
+    if (statistics) {
+        chrono::duration<double> elapsed = clock_type::now() - start;
+        cerr << fixed << setprecision(3) << "Elapsed " << elapsed.count() << " s, " << batch_count << " batches of "
+            << rows_per_batch << " rows in use\n"
+            << "Stage          rows   batches    busy s    M rows/s busy   M rows/s overall\n";
+        auto report = [&](string name, const stage_counters& c) {
+            chrono::duration<double> busy = c.busy;
+            cerr << left << setw(12) << name << right << setw(10) << c.rows << setw(10) << c.batches
+                << setw(10) << busy.count() << setw(16) << setprecision(2) << c.rows / max(busy.count(), 1e-9) / 1e6
+                << setw(19) << c.rows / elapsed.count() / 1e6 << setprecision(3) << '\n';
+        };
+        report("parse", parse_stage);
+        for (unsigned e = 0; e != evaluators; ++e) {
+            report("evaluate " + to_string(e + 1), evaluate_stages[e]);
+        }
+        report("format", format_stage);
+        cerr << "Queue          mean depth   max depth\n";
+        auto report_queue = [&](string name, const queue_counters& q) {
+            cerr << left << setw(12) << name << right << setw(13) << setprecision(2)
+                << (q.pushes ? static_cast<double>(q.total_depth) / q.pushes : 0.0) << setw(12) << q.max_depth << '\n';
+        };
+        for (unsigned e = 0; e != evaluators; ++e) {
+            report_queue("evaluate " + to_string(e + 1), evaluate_queues[e]);
+        }
+        queue_counters format_queue;
+        for (const auto& q : format_queues) {
+            format_queue.pushes += q.pushes;
+            format_queue.total_depth += q.total_depth;
+            format_queue.max_depth = max(format_queue.max_depth, q.max_depth);
+        }
+        report_queue("format", format_queue);
+    }
+}
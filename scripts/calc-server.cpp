@@ -0,0 +1,262 @@
+// calc-server.cpp : serve 08-calc calculations over a UNIX-domain socket, batching requests from all clients (Linux only)
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "calc-engine.h"
+using namespace std;
+
+// Each request is a line "x op y" and gets back one line, either "x op y = r"
+// as 08-calc prints it or one of its error messages; blank lines are ignored.
+// A client may send any number of requests without waiting for the replies,
+// which always come back in order.
+struct client {
+    int fd;
+    string in;                  // received text not yet making up a whole line
+    string out;                 // replies not yet written
+    size_t first{}, count{};    // this client's rows in the current batch
+    size_t reply_begin{}, reply_end{};
+    uint32_t interest{ EPOLLIN };
+    bool closing{}, broken{};
+};
+
+constexpr size_t max_request = 4096;            // longer lines close the connection
+constexpr size_t read_limit = 256 * 1024;       // per client in each round, for fairness
+constexpr size_t backlog_limit = 1 << 20;       // stop reading from clients which don't read their replies
+
+volatile sig_atomic_t stopping{};
+
+// Every request read in one round of epoll_wait(), from however many clients,
+// is evaluated as a single batch of columns
+struct batch {
+    vector<double> x, y, r;
+    vector<char> op;
+    vector<calc::status> error;
+    vector<bool> malformed;
+    calc::column_scratch scratch;
+    vector<char> replies;
+
+    void clear() {
+        x.clear();
+        y.clear();
+        op.clear();
+        malformed.clear();
+    }
+    void add(const calc::job& j, bool bad) {
+        x.push_back(j.x);
+        y.push_back(j.y);
+        op.push_back(j.op);
+        malformed.push_back(bad);
+    }
+    void evaluate() {
+        auto n = x.size();
+        r.resize(n);
+        error.resize(n);
+        scratch.reserve(n);
+        calc::evaluate_columns(n, x.data(), y.data(), op.data(), r.data(), error.data(), scratch);
+        replies.resize(n * calc::max_line_length);
+    }
+    // Formats rows [first, first + count) into replies starting at offset
+    size_t format(size_t first, size_t count, size_t offset) {
+        auto out = replies.data() + offset;
+        for (auto row = first; row != first + count; ++row) {
+            auto s = malformed[row] ? calc::status::bad_input : error[row];
+            if (s == calc::status::ok) {
+                out = calc::format_line(out, { x[row], y[row], op[row] }, r[row]);
+            }
+            else {
+                string_view message{ calc::message(s) };
+                out = copy(message.begin(), message.end(), out);
+            }
+        }
+        return out - replies.data();
+    }
+};
+
+// Splits off the complete lines received from c and adds them to b
+void take_requests(client& c, batch& b) {
+    c.first = b.x.size();
+    const char *begin = c.in.data(), *p = begin, *end = begin + c.in.size();
+    for (const char *newline; (newline = static_cast<const char*>(memchr(p, '\n', end - p))); p = newline + 1) {
+        if (calc::skip_space(p, newline) == newline) {
+            continue;
+        }
+        calc::job j{};
+        auto q = p;
+        bool ok = (calc::parse_job(q, newline, j) == calc::parsed::ok) && (calc::skip_space(q, newline) == newline);
+        b.add(j, !ok);
+    }
+    c.in.erase(0, p - begin);
+    if (c.in.size() > max_request) {
+        c.broken = true;
+    }
+    c.count = b.x.size() - c.first;
+}
+
+void receive(client& c) {
+    size_t received{};
+    while (received < read_limit) {
+        auto old = c.in.size();
+        c.in.resize(old + 65536);
+        auto n = ::read(c.fd, c.in.data() + old, 65536);
+        c.in.resize(old + max<ssize_t>(n, 0));
+        if (n > 0) {
+            received += n;
+        }
+        else {
+            if (n == 0) {
+                c.closing = true;
+            }
+            else if ((errno != EAGAIN) && (errno != EINTR)) {
+                c.broken = true;
+            }
+            break;
+        }
+    }
+}
+
+// Writes any replies left over from before followed by the new ones, as a
+// single gathered write, keeping whatever the socket won't yet take
+void send(client& c, const char *replies, size_t size) {
+    iovec parts[2]{ { c.out.data(), c.out.size() }, { const_cast<char*>(replies), size } };
+    auto total = c.out.size() + size;
+    if (total == 0) {
+        return;
+    }
+    auto n = ::writev(c.fd, parts, 2);
+    if (n < 0) {
+        if ((errno != EAGAIN) && (errno != EINTR)) {
+            c.broken = true;
+            return;
+        }
+        n = 0;
+    }
+    size_t written = n;
+    if (written < c.out.size()) {
+        c.out.erase(0, written);
+        c.out.append(replies, size);
+    }
+    else {
+        c.out.assign(replies + (written - c.out.size()), total - written);
+    }
+}
+
+int main(int argc, const char *argv[]) {
+    if (argc != 2) {
+        cerr << "Syntax: " << argv[0] << " <socket path>\n";
+        return 1;
+    }
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        cerr << "Socket path too long: " << argv[1] << '\n';
+        return 1;
+    }
+    strcpy(address.sun_path, argv[1]);
+    int listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    ::unlink(argv[1]);
+    if ((listener == -1) || (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)
+        || (::listen(listener, SOMAXCONN) == -1)) {
+        cerr << "Error listening on " << argv[1] << ": " << strerror(errno) << '\n';
+        return 1;
+    }
+    struct sigaction action{};
+    action.sa_handler = [](int) { stopping = 1; };
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    int epoll = ::epoll_create1(EPOLL_CLOEXEC);
+    epoll_event listen_event{ EPOLLIN, { .fd = listener } };
+    ::epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &listen_event);
+    vector<unique_ptr<client>> clients;        // indexed by file descriptor
+    vector<client*> touched;
+    vector<epoll_event> events(256);
+    batch b;
+    size_t connections{}, requests{}, batches{};
+    while (!stopping) {
+        auto ready = ::epoll_wait(epoll, events.data(), static_cast<int>(events.size()), -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cerr << "Error waiting for events: " << strerror(errno) << '\n';
+            break;
+        }
+        b.clear();
+        touched.clear();
+        for (int i = 0; i != ready; ++i) {
+            auto fd = events[i].data.fd;
+            if (fd == listener) {
+                for (int accepted; (accepted = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1; ) {
+                    if (clients.size() <= static_cast<size_t>(accepted)) {
+                        clients.resize(accepted + 1);
+                    }
+                    clients[accepted] = make_unique<client>();
+                    clients[accepted]->fd = accepted;
+                    epoll_event e{ EPOLLIN, { .fd = accepted } };
+                    ::epoll_ctl(epoll, EPOLL_CTL_ADD, accepted, &e);
+                    ++connections;
+                }
+                continue;
+            }
+            auto& c = *clients[fd];
+            c.count = 0;
+            touched.push_back(&c);
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                receive(c);
+                take_requests(c, b);
+            }
+        }
+        if (!b.x.empty()) {
+            b.evaluate();
+            requests += b.x.size();
+            ++batches;
+        }
+        size_t offset{};
+        for (auto c : touched) {
+            c->reply_begin = offset;
+            c->reply_end = offset = b.format(c->first, c->count, offset);
+        }
+        for (auto c : touched) {
+            if (!c->broken) {
+                send(*c, b.replies.data() + c->reply_begin, c->reply_end - c->reply_begin);
+            }
+            if (c->broken || (c->closing && c->out.empty())) {
+                ::close(c->fd);
+                clients[c->fd].reset();
+                continue;
+            }
+            uint32_t interest{};
+            if ((c->out.size() < backlog_limit) && !c->closing) {
+                interest |= EPOLLIN;
+            }
+            if (!c->out.empty()) {
+                interest |= EPOLLOUT;
+            }
+            if (interest != c->interest) {
+                epoll_event e{ interest, { .fd = c->fd } };
+                ::epoll_ctl(epoll, EPOLL_CTL_MOD, c->fd, &e);
+                c->interest = interest;
+            }
+        }
+    }
+    ::close(listener);
+    ::unlink(argv[1]);
+    cerr << connections << " connections, " << requests << " requests in " << batches << " batches";
+    if (batches) {
+        cerr << " (" << requests / batches << " per batch on average)";
+    }
+    cerr << '\n';
+}
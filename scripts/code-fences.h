@@ -0,0 +1,37 @@
+// code-fences.h : find the fenced code blocks in the tutorial's Markdown source
+
+#pragma once
+
+#include <string_view>
+#include <cstddef>
+#include "mapped-file.h"
+#include "static-match.h"
+
+struct code_fence {
+    bool cpp;                       // opened with "```cpp" rather than a plain "```"
+    std::size_t begin, end;         // offsets of the whole block, fence lines included
+    std::string_view body;          // the lines between the fences
+    std::size_t first_line, last_line;
+};
+
+// Calls f for each block in order; a block left open at the end of the text
+// runs to the end
+template<typename Func>
+void for_each_fence(std::string_view text, Func f) {
+    line_reader lines{ text };
+    std::string_view line;
+    for (auto begin = lines.position(); lines.getline(line); begin = lines.position()) {
+        bool cpp = pattern::full_match<cpp_fence>(line);
+        if (!cpp && !pattern::full_match<plain_fence>(line)) {
+            continue;
+        }
+        auto body_begin = lines.position(), body_end = body_begin;
+        auto first_line = lines.line_number() + 1, last_line = lines.line_number();
+        while (lines.getline(line) && !pattern::full_match<plain_fence>(line)) {
+            body_end = lines.position();
+            last_line = lines.line_number();
+        }
+        f(code_fence{ cpp, begin, lines.position(), text.substr(body_begin, body_end - body_begin),
+            first_line, last_line });
+    }
+}
@@ -1,57 +1,285 @@
-// extract-code.cpp : Scan a Markdown file for C++ programs
-
-#include <string>
-#include <sstream>
-#include <regex>
-#include <vector>
-#include <iostream>
-#include <fstream>
-using namespace std;
-
-int main(const int argc, const char **argv) {
-    vector<string_view> args{ argv + 1, argv + argc };
-    for (const auto& filename : args) {
-        cout << "- " << filename << ":\n";
-        string input_file, line;
-        ifstream infile{ filename.data() };
-        if (!infile) {
-            cerr << "Error opening file: " << filename << '\n';
-            return 1;
-        }
-        for (;;) {
-            getline(infile, line);
-            if (infile.eof()) {
-                break;
-            }
-            input_file += line + '\n';
-        }
-        infile.close();
-        istringstream iss{ input_file };
-        while (!iss.eof()) {
-            getline(iss, line);
-            if ((line != "```cpp") && (line != "```")) {
-                continue;
-            }
-            bool no_cpp = line == "```";
-            getline(iss, line);
-            regex is_cpp { R"(^// ([[:alnum:]_-]+\.cpp) :)" };
-            smatch matches;
-            if (regex_search(line, matches, is_cpp)) {
-                cerr << "Filename: " << matches[1] << (no_cpp ? " (no type)" : "") << '\n';
-            }
-            string output_file = matches[1];
-            ofstream header{ "headers\\"s + output_file, ios_base::binary },
-                module{ "modules\\"s + output_file, ios_base::binary };
-            while (line != "```") {
-                header << line << '\n';
-                if (line == "using namespace std;") {
-                    module << "import std;\n";
-                }
-                if (line.substr(0, 8) != "#include") {
-                    module << line << '\n';
-                }
-                getline(iss, line);
-            }
-        }
-    }
-}
\ No newline at end of file
+// extract-code.cpp : Scan a Markdown file for C++ programs
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <map>
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <array>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <csignal>
+#include "mapped-file.h"
+#include "static-match.h"
+#include "code-fences.h"
+#include "work-pool.h"
+#include "fnv-hash.h"
+using namespace std;
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+struct code_block {
+    string_view filename;
+    string_view body;       // from the filename header up to the closing fence
+    size_t offset, first_line, last_line;
+    bool no_cpp;
+};
+
+// A block is a program if its first line is a filename header, whether or not
+// the fence gives the language
+vector<code_block> scan_chapter(string_view text) {
+    vector<code_block> blocks;
+    for_each_fence(text, [&](const code_fence& fence) {
+        array<string_view, 1> matches;
+        if (pattern::match_prefix<filename_header>(fence.body, matches)) {
+            blocks.push_back({ matches[0], fence.body, static_cast<size_t>(fence.body.data() - text.data()),
+                fence.first_line, fence.last_line, !fence.cpp });
+        }
+    });
+    return blocks;
+}
+
+struct rendered_block {
+    string header, module;
+};
+
+rendered_block render_block(const code_block& block) {
+    rendered_block text;
+    text.header.reserve(block.body.size());
+    text.module.reserve(block.body.size());
+    line_reader lines{ block.body };
+    string_view line;
+    while (lines.getline(line)) {
+        text.header.append(line) += '\n';
+        if (line == "using namespace std;") {
+            text.module += "import std;\n";
+        }
+        if (!line.starts_with("#include")) {
+            text.module.append(line) += '\n';
+        }
+    }
+    return text;
+}
+
+void write_file(const string& filename, const string& contents) {
+    ofstream output{ filename, ios_base::binary };
+    output.write(contents.data(), contents.size());
+}
+
+// Pipes the program text to the compiler's standard input, its diagnostics are
+// discarded as in the build scripts
+bool compile(const string& command, const string& source) {
+    auto compiler = popen((command + " -x c++ - -o " NULL_DEVICE " >" NULL_DEVICE " 2>&1").c_str(), "w");
+    if (!compiler) {
+        return false;
+    }
+    fwrite(source.data(), 1, source.size(), compiler);
+    return pclose(compiler) == 0;
+}
+
+uint64_t hash_file(const string& filename) {
+    mapped_file existing{ filename.c_str() };
+    return existing ? fnv1a(existing.view()) : 0;
+}
+
+// Each line of the manifest holds the header and module variant hashes of one program
+struct hashes {
+    uint64_t header{}, module{};
+    bool operator==(const hashes&) const = default;
+};
+
+map<string, hashes, less<>> read_manifest(const string& filename) {
+    map<string, hashes, less<>> manifest;
+    mapped_file input_file{ filename.c_str() };
+    if (!input_file) {
+        return manifest;
+    }
+    line_reader lines{ input_file.view() };
+    string_view line;
+    while (lines.getline(line)) {
+        hashes entry;
+        if ((line.size() > 34) && from_hex(line.substr(0, 16), entry.header)
+            && from_hex(line.substr(17, 16), entry.module)) {
+            manifest[string{ line.substr(34) }] = entry;
+        }
+    }
+    return manifest;
+}
+
+void write_manifest(const string& filename, const map<string, hashes, less<>>& manifest) {
+    ofstream output{ filename, ios_base::binary };
+    for (const auto& [program, entry] : manifest) {
+        output << to_hex(entry.header) << ' ' << to_hex(entry.module) << ' ' << program << '\n';
+    }
+}
+
+// The chapter and block each program is extracted from, a later block of the
+// same name in the same chapter replaces an earlier one
+struct owner {
+    size_t chapter;
+    const code_block *block;
+};
+
+// The index has one tab-separated line per program giving where its block lies
+// in the Markdown source, so that tools can seek straight to it
+void write_index(const string& filename, const vector<string_view>& args, const vector<vector<code_block>>& chapters,
+        const map<string_view, owner>& outputs, const map<string, hashes, less<>>& manifest) {
+    ofstream output{ filename, ios_base::binary };
+    output << "# program\tchapter\toffset\tlength\tlines\theader\tmodule\n";
+    for (size_t i = 0; i != args.size(); ++i) {
+        for (const auto& block : chapters[i]) {
+            if (outputs.at(block.filename).block != &block) {
+                continue;
+            }
+            const auto& entry = manifest.find(block.filename)->second;
+            output << block.filename << '\t' << args[i] << '\t' << block.offset << '\t' << block.body.size()
+                << '\t' << block.first_line << '-' << block.last_line << '\t'
+                << to_hex(entry.header) << '\t' << to_hex(entry.module) << '\n';
+        }
+    }
+}
+
+int main(const int argc, const char **argv) {
+    unsigned jobs{ 1 };
+    bool check{};
+    bool modules{};
+    string manifest_file{ ".extract-manifest" }, index_file, compiler;
+    vector<string_view> args;
+    for (int i = 1; i != argc; ++i) {
+        string_view arg{ argv[i] };
+        if ((arg == "-j") && (i + 1 != argc)) {
+            jobs = atoi(argv[++i]);
+        }
+        else if (arg.starts_with("-j")) {
+            jobs = atoi(argv[i] + 2);
+        }
+        else if (arg == "--check") {
+            check = true;
+        }
+        else if ((arg == "--manifest") && (i + 1 != argc)) {
+            manifest_file = argv[++i];
+        }
+        else if (((arg == "--compile") || (arg == "--compile-modules")) && (i + 1 != argc)) {
+            modules = arg == "--compile-modules";
+            compiler = argv[++i];
+        }
+        else if ((arg == "--index") && (i + 1 != argc)) {
+            index_file = argv[++i];
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+
+    deque<mapped_file> input_files;
+    for (const auto& filename : args) {
+        if (!input_files.emplace_back(filename.data())) {
+            cerr << "Error opening file: " << filename << '\n';
+            return 1;
+        }
+    }
+
+    // Chapters are scanned in parallel, then reported in command-line order
+    work_pool pool{ jobs };
+    vector<vector<code_block>> chapters(args.size());
+    for (size_t i = 0; i != args.size(); ++i) {
+        pool.submit([&, i] { chapters[i] = scan_chapter(input_files[i].view()); });
+    }
+    pool.wait();
+
+    map<string_view, owner> outputs;
+    bool conflict{};
+    for (size_t i = 0; i != args.size(); ++i) {
+        cout << "- " << args[i] << ":\n";
+        for (const auto& block : chapters[i]) {
+            cerr << "Filename: " << block.filename << (block.no_cpp ? " (no type)" : "") << '\n';
+            auto [iter, inserted] = outputs.try_emplace(block.filename, owner{ i, &block });
+            if (inserted || (iter->second.chapter == i)) {
+                iter->second.block = &block;
+            }
+            else {
+                cerr << "Error: " << block.filename << " is in both "
+                    << args[iter->second.chapter] << " and " << args[i] << '\n';
+                conflict = true;
+            }
+        }
+    }
+    if (conflict) {
+        return 1;
+    }
+
+    // Unchanged programs are left alone so that their timestamps are kept; with
+    // --check the files on disk are compared and with --compile each program
+    // is fed to the compiler, and in both cases nothing is written
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    auto manifest = read_manifest(manifest_file);
+    struct result {
+        hashes entry;
+        bool changed{};
+    };
+    vector<result> results(outputs.size());
+    size_t index{};
+    for (const auto& [filename, output] : outputs) {
+        auto previous = manifest.find(filename);
+        pool.submit([&, block = output.block, previous, index] {
+            auto text = render_block(*block);
+            auto& r = results[index];
+            r.entry = { fnv1a(text.header), fnv1a(text.module) };
+            string program{ block->filename };
+            auto header_file = "headers/" + program, module_file = "modules/" + program;
+            if (!compiler.empty()) {
+                r.changed = !compile(compiler, modules ? text.module : text.header);
+            }
+            else if (check) {
+                r.changed = r.entry != hashes{ hash_file(header_file), hash_file(module_file) };
+            }
+            else if ((previous == manifest.end()) || (previous->second != r.entry)
+                || !filesystem::exists(header_file) || !filesystem::exists(module_file)) {
+                write_file(header_file, text.header);
+                write_file(module_file, text.module);
+                r.changed = true;
+            }
+        });
+        ++index;
+    }
+    pool.wait();
+
+    size_t changed{};
+    index = 0;
+    for (const auto& [filename, output] : outputs) {
+        if (!compiler.empty()) {
+            cout << filename << (results[index].changed ? ": failed\n" : ": passed\n");
+            changed += results[index].changed;
+        }
+        else if (results[index].changed) {
+            cout << (check ? "Changed: " : "Updated: ") << filename << '\n';
+            ++changed;
+        }
+        manifest[string{ filename }] = results[index++].entry;
+    }
+    if (!compiler.empty()) {
+        cout << "A total of " << changed << " files failed to compile.\n";
+        return changed ? 1 : 0;
+    }
+    if (check) {
+        cout << changed << " of " << outputs.size() << " programs differ from the Markdown source.\n";
+        return changed ? 1 : 0;
+    }
+    write_manifest(manifest_file, manifest);
+    if (!index_file.empty()) {
+        write_index(index_file, args, chapters, outputs, manifest);
+    }
+    cout << changed << " of " << outputs.size() << " programs written.\n";
+}
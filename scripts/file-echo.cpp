@@ -0,0 +1,191 @@
+// file-echo.cpp : 08-file1 for large files, copying to standard output inside the kernel where it can (POSIX)
+
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+using namespace std;
+
+enum class method { automatic, copy_file_range, sendfile, splice, buffer };
+
+constexpr size_t buffer_size = 1 << 20, buffer_alignment = 4096, chunk_size = 1 << 30;
+
+const char *name(method m) {
+    switch (m) {
+    case method::copy_file_range:
+        return "copy_file_range";
+    case method::sendfile:
+        return "sendfile";
+    case method::splice:
+        return "splice";
+    case method::buffer:
+        return "buffer";
+    default:
+        return "automatic";
+    }
+}
+
+enum class failure { none, reading, writing, copying };
+
+// Reads and writes through one page-aligned buffer, for when the kernel can't
+// copy between the two files itself
+failure copy_buffered(int in, int out, size_t& copied) {
+    unique_ptr<char, decltype(&free)> buffer{ static_cast<char*>(aligned_alloc(buffer_alignment, buffer_size)), &free };
+    for (;;) {
+        auto n = ::read(in, buffer.get(), buffer_size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return failure::reading;
+        }
+        if (n == 0) {
+            return failure::none;
+        }
+        for (ssize_t written{}; written != n; ) {
+            auto w = ::write(out, buffer.get() + written, n - written);
+            if (w < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return failure::writing;
+            }
+            written += w;
+        }
+        copied += n;
+    }
+}
+
+#ifdef __linux__
+// Each kernel method copies until the end of the input; if it fails before
+// copying anything (because the kernel doesn't support it for these files)
+// the next is tried, ending with the buffered copy
+bool copy_in_kernel(int in, int out, method m, size_t& copied) {
+    for (;;) {
+        ssize_t n{};
+        switch (m) {
+        case method::copy_file_range:
+            n = ::copy_file_range(in, nullptr, out, nullptr, chunk_size, 0);
+            break;
+        case method::sendfile:
+            n = ::sendfile(out, in, nullptr, chunk_size);
+            break;
+        case method::splice:
+            n = ::splice(in, nullptr, out, nullptr, chunk_size, SPLICE_F_MOVE | SPLICE_F_MORE);
+            break;
+        default:
+            return false;
+        }
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        copied += n;
+    }
+}
+#endif
+
+// As with 08-file1, a file which cannot be opened gives no output
+int main(int argc, const char *argv[]) {
+    auto requested = method::automatic;
+    bool verbose{}, bad_option{};
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-') && argv[i][1]; ++i) {
+        string_view option{ argv[i] };
+        if ((option == "-m") && (i + 1 < argc)) {
+            string_view value{ argv[++i] };
+            bool known{};
+            for (auto m : { method::automatic, method::copy_file_range, method::sendfile, method::splice, method::buffer }) {
+                if (value == name(m)) {
+                    requested = m;
+                    known = true;
+                }
+            }
+            if (!known) {
+                bad_option = true;
+                break;
+            }
+        }
+        else if (option == "-v") {
+            verbose = true;
+        }
+        else {
+            break;
+        }
+    }
+    if (bad_option || (i + 1 != argc)) {
+        cerr << "Syntax: " << argv[0] << " [-m automatic|copy_file_range|sendfile|splice|buffer] [-v] <text file name>\n";
+        return 1;
+    }
+    int in = ::open(argv[i], O_RDONLY);
+    if (in == -1) {
+        return 0;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // By default: a copy within the filesystem for a regular file, splice()
+    // for a pipe, and sendfile() for anything else (a socket or a terminal)
+    vector<method> methods;
+    if (requested == method::automatic) {
+        struct stat out_stat {};
+        fstat(STDOUT_FILENO, &out_stat);
+        if (S_ISREG(out_stat.st_mode)) {
+            methods = { method::copy_file_range, method::sendfile };
+        }
+        else if (S_ISFIFO(out_stat.st_mode)) {
+            methods = { method::splice, method::sendfile };
+        }
+        else {
+            methods = { method::sendfile };
+        }
+    }
+    else if (requested != method::buffer) {
+        methods = { requested };
+    }
+    size_t copied{};
+    auto used = method::buffer;
+    auto result = failure::none;
+    bool copied_in_kernel{};
+#ifdef __linux__
+    for (auto m : methods) {
+        copied_in_kernel = copy_in_kernel(in, STDOUT_FILENO, m, copied);
+        if (copied_in_kernel || copied) {
+            used = m;
+            break;
+        }
+    }
+    // Once some of the file has been copied the kernel can't be refused the
+    // method, so this is an error on one file or the other
+    if (!copied_in_kernel && copied) {
+        result = failure::copying;
+    }
+#endif
+    if (!copied_in_kernel && !copied) {
+        result = copy_buffered(in, STDOUT_FILENO, copied);
+    }
+    auto error = errno;
+    if (verbose) {
+        cerr << copied << " bytes copied with " << name(used) << '\n';
+    }
+    if (result != failure::none) {
+        cerr << ((result == failure::reading) ? "Error reading input: "
+            : (result == failure::writing) ? "Error writing output: " : "Error copying: ") << strerror(error) << '\n';
+        return 1;
+    }
+}
@@ -0,0 +1,33 @@
+// fnv-hash.h : 64-bit FNV-1a hash of a block of text, with hex conversion for manifests
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <charconv>
+#include <algorithm>
+#include <cstdint>
+
+constexpr std::uint64_t fnv1a(std::string_view text, std::uint64_t hash = 14695981039346656037ull) {
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static_assert(fnv1a("") == 14695981039346656037ull);
+static_assert(fnv1a("a") == 0xaf63dc4c8601ec8cull);
+
+inline std::string to_hex(std::uint64_t hash) {
+    std::string hex(16, '0');
+    char digits[16];
+    auto end = std::to_chars(digits, digits + 16, hash, 16).ptr;
+    std::copy(digits, end, hex.end() - (end - digits));
+    return hex;
+}
+
+inline bool from_hex(std::string_view hex, std::uint64_t& hash) {
+    auto [end, ec] = std::from_chars(hex.data(), hex.data() + hex.size(), hash, 16);
+    return (ec == std::errc{}) && (end == hex.data() + hex.size());
+}
@@ -0,0 +1,208 @@
+// large-filebuf.h : an input stream buffer reading a file in large aligned blocks, for std::istream
+
+#pragma once
+
+#include <istream>
+#include <streambuf>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Reads straight from the file descriptor into a buffer of buffer_size bytes
+// (rounded up to whole pages, and aligned to a page), rather than the few
+// kilobytes std::filebuf uses. sgetn() (and so istream::read()) copies what
+// is left in the buffer and then reads whole buffers' worth directly into the
+// caller's memory. There is no conversion of line endings, as for a stream
+// opened in binary mode, and no output.
+class large_filebuf : public std::streambuf {
+public:
+    static constexpr std::size_t page_size = 4096, default_buffer_size = 1 << 20;
+
+    large_filebuf() = default;
+
+    explicit large_filebuf(const char *filename, std::size_t buffer_size = default_buffer_size, bool sequential = true) {
+        open(filename, buffer_size, sequential);
+    }
+
+    ~large_filebuf() override {
+        close();
+    }
+
+    large_filebuf(const large_filebuf&) = delete;
+    large_filebuf& operator=(const large_filebuf&) = delete;
+
+    // With sequential set, the kernel is told to read ahead aggressively
+    // (posix_fadvise() with POSIX_FADV_SEQUENTIAL, where available)
+    large_filebuf *open(const char *filename, std::size_t buffer_size = default_buffer_size, bool sequential = true) {
+        if (is_open()) {
+            return nullptr;
+        }
+#ifdef _WIN32
+        fd = ::_open(filename, _O_RDONLY | _O_BINARY);
+#else
+        fd = ::open(filename, O_RDONLY);
+#endif
+        if (fd == -1) {
+            return nullptr;
+        }
+#if defined(POSIX_FADV_SEQUENTIAL)
+        if (sequential) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+#else
+        (void)sequential;
+#endif
+        capacity = (std::max<std::size_t>(buffer_size, 1) + page_size - 1) / page_size * page_size;
+#ifdef _WIN32
+        buffer = static_cast<char*>(::_aligned_malloc(capacity, page_size));
+#else
+        buffer = static_cast<char*>(std::aligned_alloc(page_size, capacity));
+#endif
+        if (!buffer) {
+            close();
+            return nullptr;
+        }
+        setg(buffer, buffer, buffer);
+        return this;
+    }
+
+    large_filebuf *close() {
+        if (!is_open()) {
+            return nullptr;
+        }
+#ifdef _WIN32
+        ::_close(fd);
+        ::_aligned_free(buffer);
+#else
+        ::close(fd);
+        std::free(buffer);
+#endif
+        fd = -1;
+        buffer = nullptr;
+        setg(nullptr, nullptr, nullptr);
+        return this;
+    }
+
+    bool is_open() const { return fd != -1; }
+
+    std::size_t buffer_size() const { return capacity; }
+
+protected:
+    int_type underflow() override {
+        if (gptr() == egptr()) {
+            auto n = is_open() ? read_some(buffer, capacity) : 0;
+            if (n <= 0) {
+                return traits_type::eof();
+            }
+            setg(buffer, buffer, buffer + n);
+        }
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::streamsize xsgetn(char *s, std::streamsize count) override {
+        std::streamsize copied = std::min<std::streamsize>(count, egptr() - gptr());
+        std::memcpy(s, gptr(), copied);
+        advance(copied);
+        while (copied != count) {
+            auto wanted = count - copied;
+            if (static_cast<std::size_t>(wanted) >= capacity) {
+                auto n = read_some(s + copied, wanted);
+                if (n <= 0) {
+                    break;
+                }
+                copied += n;
+            }
+            else {
+                if (traits_type::eq_int_type(underflow(), traits_type::eof())) {
+                    break;
+                }
+                auto n = std::min<std::streamsize>(wanted, egptr() - gptr());
+                std::memcpy(s + copied, gptr(), n);
+                advance(n);
+                copied += n;
+            }
+        }
+        return copied;
+    }
+
+    pos_type seekoff(off_type offset, std::ios_base::seekdir direction, std::ios_base::openmode which) override {
+        if (!is_open() || !(which & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        int whence = SEEK_SET;
+        if (direction == std::ios_base::cur) {
+            // The file position is at the end of what has been buffered
+            offset -= egptr() - gptr();
+            whence = SEEK_CUR;
+        }
+        else if (direction == std::ios_base::end) {
+            whence = SEEK_END;
+        }
+#ifdef _WIN32
+        auto position = ::_lseeki64(fd, offset, whence);
+#else
+        auto position = ::lseek(fd, offset, whence);
+#endif
+        if (position == -1) {
+            return pos_type(off_type(-1));
+        }
+        setg(buffer, buffer, buffer);
+        return pos_type(off_type(position));
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode which) override {
+        return seekoff(off_type(position), std::ios_base::beg, which);
+    }
+
+private:
+    // gbump() takes an int, which a buffer of 2 GiB or more would overflow
+    void advance(std::streamsize n) {
+        setg(eback(), gptr() + n, egptr());
+    }
+
+    std::streamsize read_some(char *s, std::streamsize count) {
+#ifdef _WIN32
+        return ::_read(fd, s, static_cast<unsigned>(std::min<std::streamsize>(count, 1 << 30)));
+#else
+        for (;;) {
+            auto n = ::read(fd, s, static_cast<std::size_t>(count));
+            if ((n != -1) || (errno != EINTR)) {
+                return n;
+            }
+        }
+#endif
+    }
+
+    int fd{ -1 };
+    char *buffer{};
+    std::size_t capacity{};
+};
+
+// A drop-in replacement for std::ifstream (for reading) using large_filebuf
+class large_ifstream : public std::istream {
+public:
+    explicit large_ifstream(const char *filename, std::size_t buffer_size = large_filebuf::default_buffer_size, bool sequential = true)
+        : std::istream{ nullptr }, file{ filename, buffer_size, sequential } {
+        init(&file);
+        if (!file.is_open()) {
+            setstate(std::ios_base::failbit);
+        }
+    }
+
+    large_filebuf *rdbuf() const { return const_cast<large_filebuf*>(&file); }
+    bool is_open() const { return file.is_open(); }
+
+private:
+    large_filebuf file;
+};
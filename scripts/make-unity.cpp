@@ -0,0 +1,200 @@
+// make-unity.cpp : combine example programs into unity translation units for one multi-call binary
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include "mapped-file.h"
+using namespace std;
+
+struct program {
+    string name, ident, body, call;
+    vector<string> includes;
+};
+
+// Index of the brace closing the block opened at text[open], skipping over
+// comments and string and character literals (raw strings included)
+size_t matching_brace(string_view text, size_t open) {
+    int depth{};
+    for (auto i = open; i < text.size(); ++i) {
+        auto c = text[i];
+        if (text.substr(i).starts_with("//")) {
+            i = text.find('\n', i);
+        }
+        else if (text.substr(i).starts_with("/*")) {
+            i = text.find("*/", i + 2);
+            if (i == string_view::npos) {
+                break;
+            }
+            ++i;
+        }
+        else if ((c == 'R') && (i + 1 < text.size()) && (text[i + 1] == '"')
+            && ((i == 0) || !(isalnum(static_cast<unsigned char>(text[i - 1])) || (text[i - 1] == '_')))) {
+            auto paren = text.find('(', i);
+            if (paren == string_view::npos) {
+                break;
+            }
+            auto delimiter = ")"s.append(text.substr(i + 2, paren - i - 2)) + '"';
+            i = text.find(delimiter, paren);
+            if (i == string_view::npos) {
+                break;
+            }
+            i += delimiter.size() - 1;
+        }
+        else if ((c == '"') || ((c == '\'') && !isxdigit(static_cast<unsigned char>(text[i - 1])))) {
+            for (++i; (i < text.size()) && (text[i] != c); ++i) {
+                i += text[i] == '\\';
+            }
+        }
+        else if (c == '{') {
+            ++depth;
+        }
+        else if ((c == '}') && (--depth == 0)) {
+            return i;
+        }
+        if (i == string_view::npos) {
+            break;
+        }
+    }
+    return string_view::npos;
+}
+
+// The #include lines are hoisted out so the rest can go inside a namespace;
+// main() gets a final "return 0;" as only ::main returns 0 implicitly
+bool load_program(const string& filename, program& p) {
+    mapped_file source{ filename.c_str() };
+    if (!source) {
+        cerr << "Error opening file: " << filename << '\n';
+        return false;
+    }
+    auto text = source.view();
+    for (auto unsupported : { "template<>", "template <>", "namespace std {", "#define" }) {
+        if (text.find(unsupported) != string_view::npos) {
+            cerr << "Skipping " << filename << ": contains " << unsupported << '\n';
+            return false;
+        }
+    }
+    p.name = filesystem::path{ filename }.stem().string();
+    p.ident = "ex_" + p.name;
+    replace_if(p.ident.begin(), p.ident.end(), [](char c) { return !isalnum(static_cast<unsigned char>(c)); }, '_');
+    line_reader lines{ text };
+    string_view line;
+    while (lines.getline(line)) {
+        if (line.starts_with("#include")) {
+            p.includes.emplace_back(line);
+        }
+        else {
+            p.body.append(line) += '\n';
+        }
+    }
+    auto main_at = p.body.find("\nint main(");
+    auto close = (main_at == string::npos) ? string::npos : matching_brace(p.body, p.body.find('{', main_at));
+    if (close == string::npos) {
+        cerr << "Skipping " << filename << ": no main() found\n";
+        return false;
+    }
+    p.body.insert(close, "    return 0;\n");
+    auto parameters = string_view{ p.body }.substr(main_at + 10);
+    parameters = parameters.substr(0, parameters.find(')'));
+    if (parameters.find_first_not_of(" void") == string_view::npos) {
+        p.call = "main()";
+    }
+    else if (parameters.find("const") != string_view::npos) {
+        p.call = "main(argc, argv)";
+    }
+    else {
+        p.call = "main(argc, const_cast<char**>(argv))";
+    }
+    return true;
+}
+
+void write_unity_file(const filesystem::path& filename, const vector<program>& programs) {
+    ofstream out{ filename, ios_base::binary };
+    out << "// " << filename.filename().string() << " : generated by make-unity from";
+    set<string> includes;
+    for (const auto& p : programs) {
+        out << ' ' << p.name << ".cpp";
+        includes.insert(p.includes.begin(), p.includes.end());
+    }
+    out << "\n\n";
+    for (const auto& include : includes) {
+        out << include << '\n';
+    }
+    for (const auto& p : programs) {
+        out << "\nnamespace " << p.ident << " {\n\n" << p.body
+            << "\nint unity_run([[maybe_unused]] int argc, [[maybe_unused]] const char **argv) {\n"
+            << "    return " << p.call << ";\n"
+            << "}\n\n} // namespace " << p.ident << '\n';
+    }
+}
+
+// The program to run is chosen by the name the binary is invoked as (so that
+// links named after each program work), or else by the first argument
+void write_dispatcher(const filesystem::path& filename, const vector<program>& programs) {
+    ofstream out{ filename, ios_base::binary };
+    out << "// " << filename.filename().string() << " : generated by make-unity, runs one of "
+        << programs.size() << " programs\n\n"
+           "#include <string_view>\n#include <iostream>\n\n";
+    for (const auto& p : programs) {
+        out << "namespace " << p.ident << " { int unity_run(int, const char **); }\n";
+    }
+    out << "\nstruct unity_program {\n"
+           "    std::string_view name;\n"
+           "    int (*run)(int, const char **);\n"
+           "};\n\n"
+           "constexpr unity_program programs[] = {\n";
+    for (const auto& p : programs) {
+        out << "    { \"" << p.name << "\", " << p.ident << "::unity_run },\n";
+    }
+    out << "};\n\n"
+           "int main(int argc, const char **argv) {\n"
+           "    std::string_view self{ argv[0] };\n"
+           "    self.remove_prefix(self.find_last_of(\"/\\\\\") + 1);\n"
+           "    for (const auto& program : programs) {\n"
+           "        if (program.name == self) {\n"
+           "            return program.run(argc, argv);\n"
+           "        }\n"
+           "    }\n"
+           "    for (const auto& program : programs) {\n"
+           "        if ((argc > 1) && (program.name == argv[1])) {\n"
+           "            return program.run(argc - 1, argv + 1);\n"
+           "        }\n"
+           "    }\n"
+           "    std::cerr << \"Syntax: \" << argv[0] << \" <program> [arguments]\\nPrograms:\";\n"
+           "    for (const auto& program : programs) {\n"
+           "        std::cerr << ' ' << program.name;\n"
+           "    }\n"
+           "    std::cerr << '\\n';\n"
+           "    return 1;\n"
+           "}\n";
+}
+
+int main(const int argc, const char **argv) {
+    if (argc < 4) {
+        cerr << "Syntax: " << argv[0] << " <output directory> <programs per file> <source file>...\n";
+        return 1;
+    }
+    filesystem::path directory{ argv[1] };
+    size_t per_file = max(1, atoi(argv[2]));
+    vector<program> programs;
+    for (int i = 3; i != argc; ++i) {
+        program p;
+        if (load_program(argv[i], p)) {
+            programs.push_back(move(p));
+        }
+    }
+    filesystem::create_directories(directory);
+    for (size_t first = 0, n = 1; first < programs.size(); first += per_file, ++n) {
+        vector<program> chunk(programs.begin() + first, programs.begin() + min(first + per_file, programs.size()));
+        auto filename = directory / ("unity-" + to_string(n) + ".cpp");
+        write_unity_file(filename, chunk);
+        cout << filename.string() << '\n';
+    }
+    write_dispatcher(directory / "unity-main.cpp", programs);
+    cout << (directory / "unity-main.cpp").string() << '\n';
+}
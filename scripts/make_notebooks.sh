@@ -1,10 +1,17 @@
 #!/bin/bash
 
-# Note: in order to be recognized as code blocks, must start with: ```python
+# Builds md-to-ipynb (if it is missing or older than its source or any header
+# it includes) and converts each chapter; notebooks are only rewritten when
+# their contents change
 
 srcdir="$(dirname "$(readlink -f "$0")")/.."
-destdir="$srcdir/jupyter-notebooks"
-for f in "$srcdir"/{01,02,03,04,05,06,07,08,09,10}-*.md ; do
-  out="$destdir/$(basename "$f")"
-  cat "$f" | sed 's/```cpp/```python/' | jupytext --from md --to notebook -k cpp23 -o "${out%%.md}.ipynb"
+tool="$srcdir/scripts/md-to-ipynb"
+rebuild=
+[ -x "$tool" ] || rebuild=1
+for source in md-to-ipynb.cpp code-fences.h mapped-file.h static-match.h work-pool.h fnv-hash.h ; do
+  [ "$srcdir/scripts/$source" -nt "$tool" ] && rebuild=1
 done
+if [ -n "$rebuild" ] ; then
+  ${CXX:-g++} -std=c++23 -O2 -pthread -o "$tool" "$srcdir/scripts/md-to-ipynb.cpp" || exit 1
+fi
+"$tool" -j 0 -o "$srcdir/jupyter-notebooks" "$srcdir"/{01,02,03,04,05,06,07,08,09,10}-*.md
@@ -0,0 +1,190 @@
+// mapped-file.h : memory mappings of whole files, for reading or writing, plus a line reader
+
+#pragma once
+
+#include <string_view>
+#include <algorithm>
+#include <cstddef>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+class mapped_file {
+public:
+    explicit mapped_file(const char *filename) {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        LARGE_INTEGER size{};
+        if (GetFileSizeEx(file, &size) && size.QuadPart == 0) {
+            ok = true;
+        }
+        else if (size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+                length = static_cast<std::size_t>(size.QuadPart);
+                ok = data != nullptr;
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(filename, O_RDONLY);
+        if (fd == -1) {
+            return;
+        }
+        struct stat st{};
+        if (::fstat(fd, &st) == 0) {
+            if (st.st_size == 0) {
+                ok = true;
+            }
+            else {
+                void *p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+                    data = static_cast<const char*>(p);
+                    length = static_cast<std::size_t>(st.st_size);
+                    ok = true;
+                }
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~mapped_file() {
+        if (data) {
+#ifdef _WIN32
+            UnmapViewOfFile(data);
+#else
+            ::munmap(const_cast<char*>(data), length);
+#endif
+        }
+    }
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    explicit operator bool() const { return ok; }
+    std::string_view view() const { return { data, length }; }
+
+private:
+    const char *data{};
+    std::size_t length{};
+    bool ok{};
+};
+
+// Creates (or truncates) a file of the given size and maps it for writing;
+// the contents reach the file when the mapping is destroyed
+class mapped_output {
+public:
+    mapped_output(const char *filename, std::size_t size) : length{ size } {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        if (size == 0) {
+            ok = true;
+        }
+        else {
+            LARGE_INTEGER large{};
+            large.QuadPart = static_cast<LONGLONG>(size);
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE,
+                static_cast<DWORD>(large.HighPart), large.LowPart, nullptr);
+            if (mapping) {
+                data = static_cast<char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+                CloseHandle(mapping);
+                ok = data != nullptr;
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            return;
+        }
+        if (size == 0) {
+            ok = true;
+        }
+        else if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+            void *p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p != MAP_FAILED) {
+                data = static_cast<char*>(p);
+                ok = true;
+            }
+        }
+        ::close(fd);
+#endif
+    }
+
+    ~mapped_output() {
+        if (data) {
+#ifdef _WIN32
+            UnmapViewOfFile(data);
+#else
+            ::munmap(data, length);
+#endif
+        }
+    }
+
+    mapped_output(const mapped_output&) = delete;
+    mapped_output& operator=(const mapped_output&) = delete;
+
+    explicit operator bool() const { return ok; }
+    char *begin() { return data; }
+    std::size_t size() const { return length; }
+
+private:
+    char *data{};
+    std::size_t length{};
+    bool ok{};
+};
+
+// Hands out successive lines of a buffer without copying; a trailing '\r' is
+// dropped so that CRLF files scan the same as they would in text mode
+class line_reader {
+public:
+    explicit line_reader(std::string_view buffer) : text{ buffer } {}
+
+    bool getline(std::string_view& line) {
+        if (pos >= text.size()) {
+            line = {};
+            return false;
+        }
+        auto end = text.find('\n', pos);
+        if (end == std::string_view::npos) {
+            end = text.size();
+        }
+        line = text.substr(pos, end - pos);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        pos = end + 1;
+        ++count;
+        return true;
+    }
+
+    // Byte offset of the start of the next line
+    std::size_t position() const { return std::min(pos, text.size()); }
+
+    // One-based number of the line last returned
+    std::size_t line_number() const { return count; }
+
+private:
+    std::string_view text;
+    std::size_t pos{}, count{};
+};
@@ -0,0 +1,194 @@
+// md-to-ipynb.cpp : convert the tutorial's Markdown chapters to Jupyter notebooks
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include "mapped-file.h"
+#include "code-fences.h"
+#include "work-pool.h"
+#include "fnv-hash.h"
+using namespace std;
+
+// Escaped as Python's json module does with ensure_ascii=False, so that the
+// output matches the notebooks previously written by jupytext
+void append_json_string(string& out, string_view text) {
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+        case '"':
+            out += "\\\"";
+            break;
+        case '\\':
+            out += "\\\\";
+            break;
+        case '\n':
+            out += "\\n";
+            break;
+        case '\r':
+            out += "\\r";
+            break;
+        case '\t':
+            out += "\\t";
+            break;
+        case '\b':
+            out += "\\b";
+            break;
+        case '\f':
+            out += "\\f";
+            break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+// Markdown cells lose their leading and trailing blank lines, and one with
+// nothing left is dropped
+void append_cell(string& out, bool code, string_view text, size_t index) {
+    vector<string_view> source;
+    line_reader lines{ text };
+    string_view line;
+    while (lines.getline(line)) {
+        source.push_back(line);
+    }
+    if (!code) {
+        while (!source.empty() && source.front().empty()) {
+            source.erase(source.begin());
+        }
+        while (!source.empty() && source.back().empty()) {
+            source.pop_back();
+        }
+        if (source.empty()) {
+            return;
+        }
+    }
+    if (index != 0) {
+        out += ",\n";
+    }
+    auto id = to_hex(fnv1a(text, fnv1a(code ? "code" : "markdown") + index)).substr(0, 8);
+    out += "  {\n   \"cell_type\": ";
+    out += code ? "\"code\",\n   \"execution_count\": null,\n" : "\"markdown\",\n";
+    out += "   \"id\": \"" + id + "\",\n   \"metadata\": {},\n";
+    if (code) {
+        out += "   \"outputs\": [],\n";
+    }
+    out += "   \"source\": [";
+    for (size_t i = 0; i != source.size(); ++i) {
+        out += (i == 0) ? "\n    " : ",\n    ";
+        append_json_string(out, (i + 1 == source.size()) ? string{ source[i] } : string{ source[i] } + '\n');
+    }
+    out += source.empty() ? "]\n  }" : "\n   ]\n  }";
+}
+
+// Only the "```cpp" blocks become code cells, plain blocks (program output)
+// stay part of the surrounding text
+string convert(string_view markdown) {
+    string out{ "{\n \"cells\": [\n" };
+    size_t index{}, text_begin{};
+    auto add = [&](bool code, string_view text) {
+        auto before = out.size();
+        append_cell(out, code, text, index);
+        index += out.size() != before;
+    };
+    for_each_fence(markdown, [&](const code_fence& fence) {
+        if (fence.cpp) {
+            add(false, markdown.substr(text_begin, fence.begin - text_begin));
+            add(true, fence.body);
+            text_begin = fence.end;
+        }
+    });
+    add(false, markdown.substr(text_begin));
+    out += "\n ],\n"
+        " \"metadata\": {\n"
+        "  \"jupytext\": {\n"
+        "   \"cell_metadata_filter\": \"-all\"\n"
+        "  },\n"
+        "  \"kernelspec\": {\n"
+        "   \"display_name\": \"C++ 23\",\n"
+        "   \"language\": \"c++\",\n"
+        "   \"name\": \"cpp23\"\n"
+        "  }\n"
+        " },\n"
+        " \"nbformat\": 4,\n"
+        " \"nbformat_minor\": 5\n"
+        "}\n";
+    return out;
+}
+
+int main(const int argc, const char **argv) {
+    unsigned jobs{ 1 };
+    filesystem::path output_directory{ "jupyter-notebooks" };
+    vector<string_view> args;
+    for (int i = 1; i != argc; ++i) {
+        string_view arg{ argv[i] };
+        if ((arg == "-j") && (i + 1 != argc)) {
+            jobs = atoi(argv[++i]);
+        }
+        else if (arg.starts_with("-j")) {
+            jobs = atoi(argv[i] + 2);
+        }
+        else if ((arg == "-o") && (i + 1 != argc)) {
+            output_directory = argv[++i];
+        }
+        else {
+            args.push_back(arg);
+        }
+    }
+    if (args.empty()) {
+        cerr << "Syntax: " << argv[0] << " [-j N] [-o output directory] <Markdown file>...\n";
+        return 1;
+    }
+
+    deque<mapped_file> input_files;
+    for (const auto& filename : args) {
+        if (!input_files.emplace_back(filename.data())) {
+            cerr << "Error opening file: " << filename << '\n';
+            return 1;
+        }
+    }
+
+    // A notebook is only rewritten if its contents would change
+    work_pool pool{ jobs };
+    vector<char> written(args.size());
+    for (size_t i = 0; i != args.size(); ++i) {
+        pool.submit([&, i] {
+            auto notebook = convert(input_files[i].view());
+            auto filename = output_directory / filesystem::path{ args[i] }.filename().replace_extension(".ipynb");
+            bool unchanged;
+            {
+                // The mapping is released before the file can be rewritten
+                mapped_file existing{ filename.string().c_str() };
+                unchanged = existing && (existing.view() == notebook);
+            }
+            if (!unchanged) {
+                ofstream output{ filename, ios_base::binary };
+                output.write(notebook.data(), notebook.size());
+                written[i] = true;
+            }
+        });
+    }
+    pool.wait();
+
+    size_t count{};
+    for (size_t i = 0; i != args.size(); ++i) {
+        if (written[i]) {
+            cout << "Updated: " << args[i] << '\n';
+            ++count;
+        }
+    }
+    cout << count << " of " << args.size() << " notebooks written.\n";
+}
@@ -0,0 +1,415 @@
+// perf-store.cpp : record per-example build and run measurements and compare them against a baseline
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <numeric>
+#include <ranges>
+#include <iterator>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <csignal>
+#include <sys/resource.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mapped-file.h"
+using namespace std;
+
+// A results file is tab-separated text: "# key<TAB>value" metadata lines, then
+// one line per program and metric holding every sample taken, for example:
+//
+//   # compiler   g++ (Debian 12.2.0-14) 12.2.0
+//   01-hello     compile_s   0.612  0.598  0.604
+//   01-hello     run_kb      3456   3456   3460
+//
+// Programs which failed to compile, or did not finish within the timeout,
+// have a "status" line instead of samples.
+struct results {
+    map<string, string> metadata;
+    map<string, map<string, vector<double>>> samples;
+    map<string, string> status;
+};
+
+const vector<string_view> metrics{ "compile_s", "compile_kb", "run_s", "run_kb" };
+
+bool read_results(const char *filename, results& r) {
+    mapped_file file{ filename };
+    if (!file) {
+        cerr << "Error opening file: " << filename << '\n';
+        return false;
+    }
+    line_reader lines{ file.view() };
+    string_view line;
+    while (lines.getline(line)) {
+        vector<string_view> fields;
+        for (size_t start{}, tab{}; tab != string_view::npos; start = tab + 1) {
+            tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab - start));
+        }
+        if (line.starts_with("# ") && (fields.size() == 2)) {
+            r.metadata.emplace(fields[0].substr(2), fields[1]);
+        }
+        else if ((fields.size() == 3) && (fields[1] == "status")) {
+            r.status.emplace(fields[0], fields[2]);
+        }
+        else if ((fields.size() > 2) && !line.starts_with('#')) {
+            auto& values = r.samples[string{ fields[0] }][string{ fields[1] }];
+            for (auto field : fields | views::drop(2)) {
+                double value{};
+                from_chars(field.data(), field.data() + field.size(), value);
+                values.push_back(value);
+            }
+        }
+    }
+    return true;
+}
+
+struct measurement {
+    double seconds;
+    long max_rss_kb;
+    int status;
+};
+
+// The peak RSS reported by wait4() includes the reaped descendants, so that a
+// compiler driver's cc1plus (or clang -cc1) is counted; a timeout is set with
+// alarm(), which survives the exec
+measurement run(const vector<string>& command, unsigned timeout) {
+    vector<char *> args;
+    for (const auto& arg : command) {
+        args.push_back(const_cast<char *>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+    auto start = chrono::steady_clock::now();
+    auto pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        alarm(timeout);
+        execvp(args[0], args.data());
+        _exit(127);
+    }
+    int status{};
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    chrono::duration<double> wall = chrono::steady_clock::now() - start;
+    return { wall.count(), usage.ru_maxrss, status };
+}
+
+string first_line_of(const string& command) {
+    string line;
+    if (auto pipe = popen((command + " 2>/dev/null").c_str(), "r")) {
+        char buffer[256];
+        if (fgets(buffer, sizeof(buffer), pipe)) {
+            line = buffer;
+        }
+        pclose(pipe);
+    }
+    while (!line.empty() && isspace(static_cast<unsigned char>(line.back()))) {
+        line.pop_back();
+    }
+    return line;
+}
+
+string machine_description() {
+    mapped_file cpuinfo{ "/proc/cpuinfo" };
+    line_reader lines{ cpuinfo.view() };
+    string_view line;
+    while (lines.getline(line)) {
+        if (line.starts_with("model name")) {
+            line.remove_prefix(min(line.find(':') + 2, line.size()));
+            return string{ line } + " (" + to_string(sysconf(_SC_NPROCESSORS_ONLN)) + " cores)";
+        }
+    }
+    return to_string(sysconf(_SC_NPROCESSORS_ONLN)) + " cores";
+}
+
+int record(int argc, const char **argv) {
+    unsigned runs{ 5 }, timeout{ 10 };
+    string compile, label, output;
+    vector<filesystem::path> sources;
+    for (int i = 0; i != argc; ++i) {
+        string_view arg{ argv[i] };
+        if ((arg == "-n") && (i + 1 != argc)) {
+            runs = max(1, atoi(argv[++i]));
+        }
+        else if ((arg == "-t") && (i + 1 != argc)) {
+            timeout = max(1, atoi(argv[++i]));
+        }
+        else if ((arg == "-o") && (i + 1 != argc)) {
+            output = argv[++i];
+        }
+        else if ((arg == "--compile") && (i + 1 != argc)) {
+            compile = argv[++i];
+        }
+        else if ((arg == "--label") && (i + 1 != argc)) {
+            label = argv[++i];
+        }
+        else if (filesystem::is_directory(arg)) {
+            for (const auto& entry : filesystem::directory_iterator{ arg }) {
+                if (entry.path().extension() == ".cpp") {
+                    sources.push_back(entry.path());
+                }
+            }
+        }
+        else {
+            sources.emplace_back(arg);
+        }
+    }
+    if (compile.empty() || sources.empty()) {
+        cerr << "Syntax: perf-store record [-n runs] [-t timeout] [-o results file] [--label name]\n"
+                "                          --compile \"compiler and flags\" <source file or directory>...\n";
+        return 1;
+    }
+    sort(sources.begin(), sources.end());
+    if (label.empty()) {
+        label = filesystem::absolute(sources.front()).parent_path().filename().string();
+    }
+
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    if (output.empty()) {
+        filesystem::create_directories("perf-results");
+        output = "perf-results/" + string{ date, 10 } + '-' + label + ".tsv";
+    }
+    ofstream out{ output, ios_base::binary };
+    if (!out) {
+        cerr << "Error creating file: " << output << '\n';
+        return 1;
+    }
+    utsname system{};
+    uname(&system);
+    istringstream words{ compile };
+    vector<string> command{ istream_iterator<string>{ words }, istream_iterator<string>{} };
+    out << "# date\t" << date << "\n# label\t" << label << "\n# host\t" << system.nodename
+        << "\n# machine\t" << machine_description() << "\n# kernel\t" << system.sysname << ' ' << system.release
+        << "\n# compiler\t" << first_line_of(command.front() + " --version") << "\n# command\t" << compile
+        << "\n# runs\t" << runs << '\n';
+
+    // Each program is compiled and then run the given number of times, one at a
+    // time so that measurements do not compete for the machine; programs read
+    // /dev/null as their standard input
+    auto binary = filesystem::temp_directory_path() / ("perf-store-" + to_string(getpid()));
+    command.insert(command.end(), { "-o", binary.string(), "" });
+    out << fixed << setprecision(4);
+    for (const auto& source : sources) {
+        auto name = source.stem().string();
+        command.back() = source.string();
+        map<string_view, vector<double>> samples;
+        string status;
+        for (unsigned r = 0; (r != runs) && status.empty(); ++r) {
+            auto m = run(command, timeout * 10);
+            if (!WIFEXITED(m.status) || (WEXITSTATUS(m.status) != 0)) {
+                status = "failed";
+            }
+            samples["compile_s"].push_back(m.seconds);
+            samples["compile_kb"].push_back(m.max_rss_kb);
+        }
+        for (unsigned r = 0; (r != runs) && status.empty(); ++r) {
+            auto m = run({ binary.string() }, timeout);
+            if (WIFSIGNALED(m.status) && (WTERMSIG(m.status) == SIGALRM)) {
+                status = "timeout";
+            }
+            samples["run_s"].push_back(m.seconds);
+            samples["run_kb"].push_back(m.max_rss_kb);
+        }
+        if (!status.empty()) {
+            out << name << "\tstatus\t" << status << '\n';
+        }
+        else {
+            for (auto metric : metrics) {
+                out << name << '\t' << metric << setprecision(metric.ends_with("_kb") ? 0 : 4);
+                for (auto value : samples[metric]) {
+                    out << '\t' << value;
+                }
+                out << '\n';
+            }
+        }
+        cout << name << ": " << (status.empty() ? "recorded" : status) << endl;
+    }
+    filesystem::remove(binary);
+    cout << "Results written to: " << output << '\n';
+    return 0;
+}
+
+// Regularized incomplete beta function I_x(a, b), by the continued fraction
+// of Numerical Recipes (modified Lentz's method)
+double incomplete_beta(double a, double b, double x) {
+    if ((x <= 0) || (x >= 1)) {
+        return (x <= 0) ? 0 : 1;
+    }
+    if (x > (a + 1) / (a + b + 2)) {
+        return 1 - incomplete_beta(b, a, 1 - x);
+    }
+    const double tiny = 1.0e-300;
+    auto front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x)) / a;
+    double f{ 1 }, c{ 1 }, d{ 0 };
+    for (int i = 0; i != 400; ++i) {
+        int m = i / 2;
+        double numerator = (i == 0) ? 1
+            : (i % 2) ? -((a + m) * (a + b + m) * x) / ((a + 2 * m) * (a + 2 * m + 1))
+            : (m * (b - m) * x) / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1 + numerator * d;
+        d = 1 / ((fabs(d) < tiny) ? tiny : d);
+        c = 1 + numerator / c;
+        c = (fabs(c) < tiny) ? tiny : c;
+        f *= c * d;
+        if (fabs(1 - c * d) < 1.0e-10) {
+            break;
+        }
+    }
+    return front * (f - 1);
+}
+
+// Two-sided p-value of Welch's t-test; samples without variance (peak RSS is
+// often exact) differ significantly exactly when their means differ
+double welch_p_value(const vector<double>& x, const vector<double>& y) {
+    auto moments = [](const vector<double>& v) {
+        auto mean = accumulate(v.begin(), v.end(), 0.0) / v.size();
+        auto squares = accumulate(v.begin(), v.end(), 0.0,
+            [mean](double sum, double value) { return sum + (value - mean) * (value - mean); });
+        return pair{ mean, squares / (v.size() - 1) };
+    };
+    if ((x.size() < 2) || (y.size() < 2)) {
+        return 1;
+    }
+    auto [mx, vx] = moments(x);
+    auto [my, vy] = moments(y);
+    auto sx = vx / x.size(), sy = vy / y.size();
+    if (sx + sy == 0) {
+        return (mx == my) ? 1 : 0;
+    }
+    auto t = (my - mx) / sqrt(sx + sy);
+    auto df = (sx + sy) * (sx + sy) / (sx * sx / (x.size() - 1) + sy * sy / (y.size() - 1));
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t));
+}
+
+double median(vector<double> values) {
+    sort(values.begin(), values.end());
+    auto n = values.size();
+    return (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+int compare(int argc, const char **argv) {
+    double threshold{ 0.05 }, alpha{ 0.05 };
+    bool verbose{};
+    vector<const char *> files;
+    for (int i = 0; i != argc; ++i) {
+        string_view arg{ argv[i] };
+        if ((arg == "--threshold") && (i + 1 != argc)) {
+            threshold = atof(argv[++i]) / 100;
+        }
+        else if ((arg == "--alpha") && (i + 1 != argc)) {
+            alpha = atof(argv[++i]);
+        }
+        else if (arg == "-v") {
+            verbose = true;
+        }
+        else {
+            files.push_back(argv[i]);
+        }
+    }
+    results baseline, candidate;
+    if ((files.size() != 2) || !read_results(files[0], baseline) || !read_results(files[1], candidate)) {
+        cerr << "Syntax: perf-store compare [-v] [--threshold percent] [--alpha level] <baseline> <candidate>\n";
+        return 1;
+    }
+    for (auto key : { "label", "compiler", "command", "machine", "date" }) {
+        if (baseline.metadata[key] != candidate.metadata[key]) {
+            cout << setw(10) << left << key << right << baseline.metadata[key] << "  ->  " << candidate.metadata[key] << '\n';
+        }
+    }
+
+    // A slowdown is flagged when the median grows by more than the threshold and
+    // the difference is significant at the given level
+    size_t slower{}, faster{}, compared{};
+    cout << '\n' << left << setw(28) << "Program" << setw(12) << "Metric" << right << setw(12) << "baseline"
+        << setw(12) << "candidate" << setw(10) << "change" << setw(10) << "p" << '\n' << fixed;
+    for (const auto& [name, by_metric] : candidate.samples) {
+        auto base = baseline.samples.find(name);
+        if (base == baseline.samples.end()) {
+            continue;
+        }
+        for (auto metric : metrics) {
+            auto x = base->second.find(string{ metric });
+            auto y = by_metric.find(string{ metric });
+            if ((x == base->second.end()) || (y == by_metric.end())) {
+                continue;
+            }
+            ++compared;
+            auto before = median(x->second), after = median(y->second);
+            auto change = (before != 0) ? after / before - 1 : 0;
+            auto p = welch_p_value(x->second, y->second);
+            bool significant = (p < alpha) && (fabs(change) > threshold);
+            slower += significant && (change > 0);
+            faster += significant && (change < 0);
+            if (significant || verbose) {
+                cout << left << setw(28) << name << setw(12) << metric << right
+                    << setprecision(metric.ends_with("_kb") ? 0 : 4) << setw(12) << before << setw(12) << after << setprecision(1) << setw(9) << showpos
+                    << change * 100 << '%' << noshowpos << setprecision(4) << setw(10) << p
+                    << (significant ? ((change > 0) ? "  SLOWER" : "  faster") : "") << '\n';
+            }
+        }
+    }
+    for (const auto& [name, status] : candidate.status) {
+        if (!baseline.status.contains(name) && baseline.samples.contains(name)) {
+            cout << left << setw(28) << name << "now " << status << right << '\n';
+            ++slower;
+        }
+    }
+    cout << '\n' << compared << " measurements compared, " << slower << " regressions, " << faster << " improvements\n";
+    return slower ? 2 : 0;
+}
+
+int list(const filesystem::path& directory) {
+    if (!filesystem::is_directory(directory)) {
+        cerr << "No results directory: " << directory.string() << '\n';
+        return 1;
+    }
+    vector<filesystem::path> files;
+    for (const auto& entry : filesystem::directory_iterator{ directory }) {
+        if (entry.path().extension() == ".tsv") {
+            files.push_back(entry.path());
+        }
+    }
+    sort(files.begin(), files.end());
+    for (const auto& file : files) {
+        results r;
+        if (read_results(file.c_str(), r)) {
+            cout << file.string() << "\n    " << r.metadata["date"] << "  " << r.metadata["label"] << "  "
+                << r.metadata["compiler"] << "\n    " << r.samples.size() << " programs, "
+                << r.status.size() << " failed or timed out\n";
+        }
+    }
+    return 0;
+}
+
+int main(const int argc, const char **argv) {
+    string_view command{ (argc > 1) ? argv[1] : "" };
+    if (command == "record") {
+        return record(argc - 2, argv + 2);
+    }
+    else if (command == "compare") {
+        return compare(argc - 2, argv + 2);
+    }
+    else if (command == "list") {
+        return list((argc > 2) ? argv[2] : "perf-results");
+    }
+    cerr << "Syntax: " << argv[0] << " record|compare|list [options]\n";
+    return 1;
+}
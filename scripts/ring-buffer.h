@@ -0,0 +1,182 @@
+// ring-buffer.h : bounded lock-free single- and multiple-producer queues between threads
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstddef>
+
+// Callers which find a queue empty or full spin briefly, yielding, before
+// sleeping with atomic wait() on the index (or slot sequence number) which
+// will change when it is not; every change is followed by a notify
+inline constexpr std::size_t spin_limit = 64;
+inline constexpr std::size_t cache_line = 64;
+
+// One producer thread and one consumer thread; the capacity must be a power
+// of two. Each index is written by one side only, and each side keeps a copy
+// of the other's index so that it rarely reads the shared one.
+template<typename T>
+class spsc_ring {
+public:
+    explicit spsc_ring(std::size_t capacity) : mask{ capacity - 1 }, slots{ std::make_unique<T[]>(capacity) } {}
+
+    bool try_push(const T& value) {
+        auto tail = write_index.load(std::memory_order_relaxed);
+        if (tail - cached_read > mask) {
+            cached_read = read_index.load(std::memory_order_acquire);
+            if (tail - cached_read > mask) {
+                return false;
+            }
+        }
+        slots[tail & mask] = value;
+        write_index.store(tail + 1, std::memory_order_release);
+        write_index.notify_one();
+        return true;
+    }
+
+    bool try_pop(T& value) {
+        auto head = read_index.load(std::memory_order_relaxed);
+        if (head == cached_write) {
+            cached_write = write_index.load(std::memory_order_acquire);
+            if (head == cached_write) {
+                return false;
+            }
+        }
+        value = slots[head & mask];
+        read_index.store(head + 1, std::memory_order_release);
+        read_index.notify_one();
+        return true;
+    }
+
+    void push(const T& value) {
+        for (std::size_t spins{}; !try_push(value); ++spins) {
+            if (spins < spin_limit) {
+                std::this_thread::yield();
+            }
+            else {
+                read_index.wait(write_index.load(std::memory_order_relaxed) - mask - 1, std::memory_order_acquire);
+            }
+        }
+    }
+
+    T pop() {
+        T value;
+        for (std::size_t spins{}; !try_pop(value); ++spins) {
+            if (spins < spin_limit) {
+                std::this_thread::yield();
+            }
+            else {
+                write_index.wait(read_index.load(std::memory_order_relaxed), std::memory_order_acquire);
+            }
+        }
+        return value;
+    }
+
+    // Approximate when called while the other side is active
+    std::size_t size() const {
+        return write_index.load(std::memory_order_relaxed) - read_index.load(std::memory_order_relaxed);
+    }
+
+private:
+    const std::size_t mask;
+    std::unique_ptr<T[]> slots;
+    alignas(cache_line) std::atomic<std::size_t> write_index{};
+    std::size_t cached_read{};
+    alignas(cache_line) std::atomic<std::size_t> read_index{};
+    std::size_t cached_write{};
+};
+
+// Any number of producer threads and one consumer thread; the capacity must
+// be a power of two. Producers claim a position with compare-and-swap, and
+// each slot's sequence number says whether it is free for the producer at
+// that position (equal to it) or full for the consumer (one more).
+template<typename T>
+class mpsc_ring {
+public:
+    explicit mpsc_ring(std::size_t capacity) : mask{ capacity - 1 }, slots{ std::make_unique<slot[]>(capacity) } {
+        for (std::size_t i = 0; i != capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(const T& value) {
+        auto position = write_index.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& s = slots[position & mask];
+            auto sequence = s.sequence.load(std::memory_order_acquire);
+            if (sequence == position) {
+                if (write_index.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    s.value = value;
+                    s.sequence.store(position + 1, std::memory_order_release);
+                    s.sequence.notify_all();
+                    return true;
+                }
+            }
+            else if (sequence < position) {
+                return false;
+            }
+            else {
+                position = write_index.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& value) {
+        auto& s = slots[read_index & mask];
+        if (s.sequence.load(std::memory_order_acquire) != read_index + 1) {
+            return false;
+        }
+        value = s.value;
+        s.sequence.store(read_index + mask + 1, std::memory_order_release);
+        s.sequence.notify_all();
+        ++read_index;
+        read_shared.store(read_index, std::memory_order_relaxed);
+        return true;
+    }
+
+    void push(const T& value) {
+        for (std::size_t spins{}; !try_push(value); ++spins) {
+            if (spins < spin_limit) {
+                std::this_thread::yield();
+            }
+            else {
+                // The slot this producer would fill is still waiting to be read
+                auto position = write_index.load(std::memory_order_relaxed);
+                auto& s = slots[position & mask];
+                auto sequence = s.sequence.load(std::memory_order_acquire);
+                if (sequence < position) {
+                    s.sequence.wait(sequence, std::memory_order_acquire);
+                }
+            }
+        }
+    }
+
+    T pop() {
+        T value;
+        for (std::size_t spins{}; !try_pop(value); ++spins) {
+            if (spins < spin_limit) {
+                std::this_thread::yield();
+            }
+            else {
+                slots[read_index & mask].sequence.wait(read_index, std::memory_order_acquire);
+            }
+        }
+        return value;
+    }
+
+    std::size_t size() const {
+        return write_index.load(std::memory_order_relaxed) - read_shared.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct slot {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+    const std::size_t mask;
+    std::unique_ptr<slot[]> slots;
+    alignas(cache_line) std::atomic<std::size_t> write_index{};
+    alignas(cache_line) std::size_t read_index{};
+    std::atomic<std::size_t> read_shared{};
+};
@@ -0,0 +1,211 @@
+// run-bench.cpp : time an interactive example program fed with a scripted standard input
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <random>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mapped-file.h"
+using namespace std;
+
+// Each generator writes an input script of (about) the given number of lines,
+// ending with whatever the program expects in order to quit
+using generator = void (*)(FILE *, size_t, mt19937&);
+
+const map<string_view, generator> generators{
+    { "calc", [](FILE *out, size_t lines, mt19937& rng) {
+        uniform_int_distribution<int> number{ -1000, 1000 }, op{ 0, 4 };
+        for (size_t i = 0; i != lines; ++i) {
+            fprintf(out, "%d %c %d\n", number(rng), "+-*/^"[op(rng)], abs(number(rng)) % 7 + 1);
+        }
+    } },
+    { "vector", [](FILE *out, size_t lines, mt19937& rng) {
+        uniform_int_distribution<int> number{ 100, 1000000 };
+        for (size_t i = 1; i < lines; ++i) {
+            fprintf(out, "%d\n", number(rng));
+        }
+        fputs("99\n", out);
+    } },
+    { "map", [](FILE *out, size_t lines, mt19937& rng) {
+        uniform_int_distribution<int> product{ 0, 999 }, choice{ 0, 3 };
+        for (size_t i = 2; i < lines; i += 2) {
+            if (choice(rng) == 0) {
+                fprintf(out, "A\nproduct%d %d.%02d\n", product(rng), product(rng) % 10, product(rng) % 100);
+            }
+            else {
+                fprintf(out, "C\nproduct%d %d\n", product(rng), product(rng) % 10 + 1);
+            }
+        }
+        fputs("Q\n", out);
+    } },
+    { "receipt", [](FILE *out, size_t lines, mt19937& rng) {
+        uniform_int_distribution<int> product{ 0, 999 };
+        for (size_t i = 1; i < lines; ++i) {
+            fprintf(out, "Product%d %d %d.%02d\n", product(rng), product(rng) % 12 + 1, product(rng) % 10, product(rng) % 100);
+        }
+        fputs("\n", out);
+    } },
+    { "pupils", [](FILE *out, size_t lines, mt19937& rng) {
+        const char *names[]{ "Paul", "Percy", "Perry", "Phoebe", "Penny", "Patricia", "Nobody" };
+        uniform_int_distribution<size_t> name{ 0, size(names) - 1 };
+        for (size_t i = 1; i < lines; ++i) {
+            fprintf(out, "%s\n", names[name(rng)]);
+        }
+        fputs("\n", out);
+    } },
+    { "lines", [](FILE *out, size_t lines, mt19937& rng) {
+        uniform_int_distribution<int> length{ 1, 79 };
+        for (size_t i = 0; i != lines; ++i) {
+            fprintf(out, "%.*s\n", length(rng), "The quick brown fox jumps over the lazy dog, "
+                "pack my box with five dozen liquor jugs.");
+        }
+    } },
+};
+
+struct run_result {
+    double wall, user, sys;
+    long max_rss_kb;
+    int status;
+};
+
+// The child's standard output goes to /dev/null so that only the program's
+// own work (including formatting its output) is measured
+run_result run_once(int input, char **command) {
+    lseek(input, 0, SEEK_SET);
+    auto start = chrono::steady_clock::now();
+    auto pid = fork();
+    if (pid == -1) {
+        cerr << "Error starting " << command[0] << ": " << strerror(errno) << '\n';
+        exit(1);
+    }
+    if (pid == 0) {
+        // A failure here is reported as the program not running to completion
+        int null = open("/dev/null", O_WRONLY);
+        if ((null == -1) || (dup2(input, STDIN_FILENO) == -1) || (dup2(null, STDOUT_FILENO) == -1)) {
+            _exit(127);
+        }
+        execvp(command[0], command);
+        _exit(127);
+    }
+    int status{};
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    chrono::duration<double> wall = chrono::steady_clock::now() - start;
+    return { wall.count(), usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1.0e6,
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1.0e6, usage.ru_maxrss, status };
+}
+
+struct statistics {
+    double mean, stddev, min, median;
+};
+
+statistics summarize(vector<double> values) {
+    sort(values.begin(), values.end());
+    auto mean = accumulate(values.begin(), values.end(), 0.0) / values.size();
+    auto squares = accumulate(values.begin(), values.end(), 0.0,
+        [mean](double sum, double v) { return sum + (v - mean) * (v - mean); });
+    auto stddev = (values.size() > 1) ? sqrt(squares / (values.size() - 1)) : 0.0;
+    auto median = (values.size() % 2) ? values[values.size() / 2]
+        : (values[values.size() / 2 - 1] + values[values.size() / 2]) / 2;
+    return { mean, stddev, values.front(), median };
+}
+
+int main(int argc, char *argv[]) {
+    size_t runs{ 5 }, lines{ 1000000 };
+    string_view kind, script;
+    int i = 1;
+    for (; (i < argc) && (argv[i][0] == '-'); ++i) {
+        string_view option{ argv[i] };
+        if (i + 1 == argc) {
+            break;
+        }
+        if (option == "-n") {
+            runs = max(1, atoi(argv[++i]));
+        }
+        else if (option == "-l") {
+            lines = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (option == "-g") {
+            kind = argv[++i];
+        }
+        else if (option == "-i") {
+            script = argv[++i];
+        }
+        else {
+            i = argc;
+        }
+    }
+    if ((i == argc) || (kind.empty() == script.empty()) || (!kind.empty() && !generators.contains(kind))) {
+        cerr << "Syntax: " << argv[0] << " [-n runs] [-l lines] (-g generator | -i input file) <program> [arguments]\n"
+            << "Generators:";
+        for (const auto& [name, g] : generators) {
+            cerr << ' ' << name;
+        }
+        cerr << '\n';
+        return 1;
+    }
+
+    auto input = tmpfile();
+    if (!input) {
+        cerr << "Error creating temporary file: " << strerror(errno) << '\n';
+        return 1;
+    }
+    if (!kind.empty()) {
+        mt19937 rng{ 42 };
+        generators.at(kind)(input, lines, rng);
+        fflush(input);
+    }
+    else {
+        mapped_file recorded{ script.data() };
+        if (!recorded) {
+            cerr << "Error opening file: " << script << '\n';
+            return 1;
+        }
+        fwrite(recorded.view().data(), 1, recorded.view().size(), input);
+        fflush(input);
+    }
+    {
+        mapped_file generated{ ("/proc/self/fd/" + to_string(fileno(input))).c_str() };
+        lines = count(generated.view().begin(), generated.view().end(), '\n');
+    }
+
+    vector<double> wall, user, sys;
+    long max_rss_kb{};
+    for (size_t r = 0; r != runs; ++r) {
+        auto result = run_once(fileno(input), argv + i);
+        if (!WIFEXITED(result.status) || (WEXITSTATUS(result.status) == 127)) {
+            cerr << "Error: " << argv[i] << " did not run to completion\n";
+            return 1;
+        }
+        wall.push_back(result.wall);
+        user.push_back(result.user);
+        sys.push_back(result.sys);
+        max_rss_kb = max(max_rss_kb, result.max_rss_kb);
+    }
+
+    cout << argv[i] << ": " << lines << " input lines, " << runs << " runs\n"
+        << fixed << setprecision(4) << setw(8) << "" << setw(10) << "mean" << setw(10) << "stddev"
+        << setw(10) << "min" << setw(10) << "median" << '\n';
+    for (auto [name, values] : { pair{ "wall", &wall }, pair{ "user", &user }, pair{ "sys", &sys } }) {
+        auto s = summarize(*values);
+        cout << setw(8) << name << setw(10) << s.mean << setw(10) << s.stddev
+            << setw(10) << s.min << setw(10) << s.median << '\n';
+    }
+    auto median_wall = summarize(wall).median;
+    cout << "Peak RSS: " << max_rss_kb << " KB\n"
+        << "Throughput: " << setprecision(0) << lines / median_wall << " lines/s (median)\n";
+}
@@ -0,0 +1,172 @@
+// static-match.h : regular patterns composed from templates, so the grammar is fixed at compile time
+
+#pragma once
+
+#include <string_view>
+#include <array>
+#include <cstddef>
+
+namespace pattern {
+
+template<std::size_t N>
+struct fixed_string {
+    char chars[N]{};
+    consteval fixed_string(const char (&s)[N]) {
+        for (std::size_t i = 0; i != N; ++i) {
+            chars[i] = s[i];
+        }
+    }
+    constexpr std::string_view view() const { return { chars, N - 1 }; }
+};
+
+// Each pattern has a static match() which tries to match at text[pos] and then
+// calls the continuation k with the end position; backtracking happens by
+// trying k again with a shorter match, just as a regex engine would
+
+template<fixed_string S>
+struct lit {
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *, Cont&& k) {
+        return text.substr(pos).starts_with(S.view()) && k(pos + S.view().size());
+    }
+};
+
+// Character class such as "A-Za-z0-9_-", a '-' at either end is literal
+template<fixed_string S>
+struct chars {
+    static constexpr std::array<bool, 256> table = [] {
+        std::array<bool, 256> t{};
+        auto spec = S.view();
+        for (std::size_t i = 0; i != spec.size(); ++i) {
+            if ((i + 2 < spec.size()) && (spec[i + 1] == '-')) {
+                for (int c = static_cast<unsigned char>(spec[i]); c <= static_cast<unsigned char>(spec[i + 2]); ++c) {
+                    t[c] = true;
+                }
+                i += 2;
+            }
+            else {
+                t[static_cast<unsigned char>(spec[i])] = true;
+            }
+        }
+        return t;
+    }();
+
+    static constexpr bool test(char c) { return table[static_cast<unsigned char>(c)]; }
+
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *, Cont&& k) {
+        return (pos < text.size()) && test(text[pos]) && k(pos + 1);
+    }
+};
+
+template<typename Class, std::size_t Min>
+struct repeat {
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *, Cont&& k) {
+        auto end = pos;
+        while ((end < text.size()) && Class::test(text[end])) {
+            ++end;
+        }
+        for (; end >= pos + Min; --end) {
+            if (k(end)) {
+                return true;
+            }
+            if (end == pos) {
+                break;
+            }
+        }
+        return false;
+    }
+};
+
+template<typename Class>
+using plus = repeat<Class, 1>;
+
+template<typename Class>
+using star = repeat<Class, 0>;
+
+template<typename... Ps>
+struct seq {
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *caps, Cont&& k) {
+        return step<Ps...>(text, pos, caps, k);
+    }
+
+private:
+    template<typename First, typename... Rest, typename Cont>
+    static constexpr bool step(std::string_view text, std::size_t pos, std::string_view *caps, Cont&& k) {
+        if constexpr (sizeof...(Rest) == 0) {
+            return First::match(text, pos, caps, k);
+        }
+        else {
+            return First::match(text, pos, caps, [&](std::size_t next) {
+                return step<Rest...>(text, next, caps, k);
+            });
+        }
+    }
+};
+
+template<typename... Ps>
+struct alt {
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *caps, Cont&& k) {
+        return (Ps::match(text, pos, caps, k) || ...);
+    }
+};
+
+template<std::size_t I, typename P>
+struct capture {
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *caps, Cont&& k) {
+        return P::match(text, pos, caps, [&](std::size_t end) {
+            auto saved = caps[I];
+            caps[I] = text.substr(pos, end - pos);
+            if (k(end)) {
+                return true;
+            }
+            caps[I] = saved;
+            return false;
+        });
+    }
+};
+
+struct eol {
+    template<typename Cont>
+    static constexpr bool match(std::string_view text, std::size_t pos, std::string_view *, Cont&& k) {
+        return (pos == text.size()) && k(pos);
+    }
+};
+
+// Anchored at the start of text, like a regex beginning with '^'
+template<typename P, std::size_t N>
+constexpr bool match_prefix(std::string_view text, std::array<std::string_view, N>& caps) {
+    return P::match(text, 0, caps.data(), [](std::size_t) { return true; });
+}
+
+template<typename P>
+constexpr bool full_match(std::string_view text) {
+    std::string_view *none{};
+    return seq<P, eol>::match(text, 0, none, [](std::size_t) { return true; });
+}
+
+} // namespace pattern
+
+// The patterns used when scanning the tutorial's Markdown source
+using cpp_fence = pattern::lit<"```cpp">;
+using plain_fence = pattern::lit<"```">;
+using filename_header = pattern::seq<pattern::lit<"// ">,
+    pattern::capture<0, pattern::seq<pattern::plus<pattern::chars<"A-Za-z0-9_-">>, pattern::lit<".cpp">>>,
+    pattern::lit<" :">>;
+
+static_assert(pattern::full_match<cpp_fence>("```cpp"));
+static_assert(!pattern::full_match<cpp_fence>("```cpp "));
+static_assert(pattern::full_match<plain_fence>("```"));
+static_assert([] {
+    std::array<std::string_view, 1> caps{};
+    return pattern::match_prefix<filename_header>("// 08-calc.cpp : read from a file", caps)
+        && (caps[0] == "08-calc.cpp");
+}());
+static_assert([] {
+    std::array<std::string_view, 1> caps{};
+    return !pattern::match_prefix<filename_header>("// 08 calc.cpp : bad name", caps);
+}());
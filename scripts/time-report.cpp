@@ -0,0 +1,202 @@
+// time-report.cpp : summarize per-program compile times from "make TIME=1" build logs
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <iomanip>
+#include <charconv>
+#include <cctype>
+#include "mapped-file.h"
+using namespace std;
+
+struct compile_times {
+    double frontend{}, templates{}, backend{}, total{};
+    bool failed{}, found{};
+};
+
+// GCC's -ftime-report gives usr, sys and wall columns for each timer, of which
+// wall time is used; template instantiation is a part of the frontend
+vector<double> report_columns(string_view text) {
+    vector<double> columns;
+    while (!text.empty()) {
+        if (text.front() == '(') {
+            text.remove_prefix(min(text.find(')'), text.size() - 1) + 1);
+            continue;
+        }
+        double value{};
+        auto [end, ec] = from_chars(text.data(), text.data() + text.size(), value);
+        if (ec == errc{}) {
+            columns.push_back(value);
+            text.remove_prefix(end - text.data());
+        }
+        else {
+            text.remove_prefix(1);
+        }
+    }
+    return columns;
+}
+
+void parse_gcc_report(string_view log, compile_times& times) {
+    line_reader lines{ log };
+    string_view line;
+    while (lines.getline(line)) {
+        auto colon = line.find(':');
+        if ((colon == string_view::npos) || !line.starts_with(' ')) {
+            continue;
+        }
+        auto name = line.substr(1, colon - 1);
+        name.remove_suffix(name.size() - name.find_last_not_of(' ') - 1);
+        auto columns = report_columns(line.substr(colon + 1));
+        if (columns.size() < 3) {
+            continue;
+        }
+        auto wall = columns[2];
+        if ((name == "phase setup") || (name == "phase parsing") || (name == "phase lang. deferred")) {
+            times.frontend += wall;
+        }
+        else if (name.starts_with("phase opt") || (name == "phase last asm") || (name == "phase finalize")) {
+            times.backend += wall;
+        }
+        else if (name == "template instantiation") {
+            times.templates += wall;
+        }
+        else if (name == "TOTAL") {
+            times.total = wall;
+            times.found = true;
+        }
+    }
+}
+
+// Clang's -ftime-trace writes "Total ..." summary events with durations in microseconds
+double trace_seconds(string_view json, string_view event) {
+    auto at = json.find("\"name\":\""s.append(event) + '"');
+    if (at == string_view::npos) {
+        return 0;
+    }
+    auto open = json.rfind('{', at), close = json.find('}', at);
+    auto object = json.substr(open, close - open);
+    auto dur = object.find("\"dur\":");
+    if (dur == string_view::npos) {
+        return 0;
+    }
+    auto digits = object.substr(dur + 6);
+    while (!digits.empty() && isspace(static_cast<unsigned char>(digits.front()))) {
+        digits.remove_prefix(1);
+    }
+    double microseconds{};
+    from_chars(digits.data(), digits.data() + digits.size(), microseconds);
+    return microseconds / 1.0e6;
+}
+
+void parse_clang_trace(string_view json, compile_times& times) {
+    times.frontend = trace_seconds(json, "Total Frontend");
+    times.templates = trace_seconds(json, "Total InstantiateFunction") + trace_seconds(json, "Total InstantiateClass");
+    times.backend = trace_seconds(json, "Total Backend");
+    times.total = trace_seconds(json, "Total ExecuteCompiler");
+    times.found = times.total != 0;
+}
+
+map<string, compile_times> read_logs(const filesystem::path& directory) {
+    map<string, compile_times> programs;
+    for (const auto& entry : filesystem::directory_iterator{ directory }) {
+        if (entry.path().extension() != ".log") {
+            continue;
+        }
+        auto& times = programs[entry.path().stem().string()];
+        mapped_file log{ entry.path().c_str() };
+        if (log) {
+            auto text = log.view();
+            times.failed = text.ends_with("FAILED\n");
+            parse_gcc_report(text, times);
+        }
+        if (!times.found) {
+            auto trace = entry.path();
+            mapped_file json{ trace.replace_extension(".json").c_str() };
+            if (json) {
+                parse_clang_trace(json.view(), times);
+            }
+        }
+    }
+    return programs;
+}
+
+int main(const int argc, const char **argv) {
+    if (argc < 2) {
+        cerr << "Syntax: " << argv[0] << " <label>=<logs directory>...\n";
+        return 1;
+    }
+    vector<string> labels;
+    vector<map<string, compile_times>> trees;
+    map<string, bool> names;
+    for (int i = 1; i != argc; ++i) {
+        string_view arg{ argv[i] };
+        auto equals = arg.find('=');
+        if ((equals == string_view::npos) || !filesystem::is_directory(arg.substr(equals + 1))) {
+            cerr << "Error: expected <label>=<logs directory>, got: " << arg << '\n';
+            return 1;
+        }
+        labels.emplace_back(arg.substr(0, equals));
+        trees.push_back(read_logs(arg.substr(equals + 1)));
+        for (const auto& [name, times] : trees.back()) {
+            names[name] = true;
+        }
+    }
+
+    // Seconds of wall time, with the ten slowest translation units marked
+    struct unit {
+        double total;
+        string name;
+        size_t tree;
+    };
+    vector<unit> units;
+    for (size_t t = 0; t != trees.size(); ++t) {
+        for (const auto& [name, times] : trees[t]) {
+            if (times.found) {
+                units.push_back({ times.total, name, t });
+            }
+        }
+    }
+    sort(units.begin(), units.end(), [](const unit& a, const unit& b) { return a.total > b.total; });
+    units.resize(min<size_t>(units.size(), 10));
+    auto slowest = [&](const string& name, size_t tree) {
+        return any_of(units.begin(), units.end(), [&](const unit& u) { return (u.name == name) && (u.tree == tree); });
+    };
+
+    cout << fixed << setprecision(2) << left << setw(24) << "Program" << right;
+    for (const auto& label : labels) {
+        cout << " | " << setw(8) << (label + " fe") << setw(8) << "tmpl" << setw(8) << "be" << setw(8) << "total" << ' ';
+    }
+    cout << '\n';
+    vector<compile_times> sums(trees.size());
+    for (const auto& [name, present] : names) {
+        cout << left << setw(24) << name << right;
+        for (size_t t = 0; t != trees.size(); ++t) {
+            auto iter = trees[t].find(name);
+            if ((iter == trees[t].end()) || !iter->second.found) {
+                cout << " | " << setw(32) << ((iter != trees[t].end() && iter->second.failed) ? "failed" : "-") << ' ';
+                continue;
+            }
+            const auto& times = iter->second;
+            cout << " | " << setw(8) << times.frontend << setw(8) << times.templates
+                << setw(8) << times.backend << setw(8) << times.total << (slowest(name, t) ? '*' : ' ');
+            sums[t].frontend += times.frontend;
+            sums[t].templates += times.templates;
+            sums[t].backend += times.backend;
+            sums[t].total += times.total;
+        }
+        cout << '\n';
+    }
+    cout << left << setw(24) << "TOTAL" << right;
+    for (const auto& sum : sums) {
+        cout << " | " << setw(8) << sum.frontend << setw(8) << sum.templates
+            << setw(8) << sum.backend << setw(8) << sum.total << ' ';
+    }
+    cout << "\n\nSlowest translation units (marked *):\n";
+    for (const auto& u : units) {
+        cout << "  " << setw(8) << u.total << "s  " << labels[u.tree] << '/' << u.name << ".cpp\n";
+    }
+}
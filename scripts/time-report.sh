@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Builds both the headers and modules versions of the programs with per-file
+# compile time reports (-ftime-report for GCC, -ftime-trace for Clang) and prints
+# a combined summary. Any arguments are passed to make, for example CXX=clang++
+
+srcdir="$(dirname "$(readlink -f "$0")")/.."
+tooldir="$(mktemp -d)"
+trap 'rm -rf "$tooldir"' EXIT
+
+g++ -std=c++23 -O2 -o "$tooldir/time-report" "$srcdir/scripts/time-report.cpp" || exit 1
+for tree in headers modules ; do
+  echo "Building $tree..."
+  make --no-print-directory -C "$srcdir/$tree/build" -j"$(nproc)" TIME=1 "$@" | tail -n 1
+done
+"$tooldir/time-report" headers="$srcdir/headers/build/logs" modules="$srcdir/modules/build/logs"
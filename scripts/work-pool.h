@@ -0,0 +1,143 @@
+// work-pool.h : fixed-size thread pool where idle workers steal queued tasks from busy ones
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class work_pool {
+public:
+    explicit work_pool(unsigned threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned i = 0; i != threads; ++i) {
+            queues.push_back(std::make_unique<task_queue>());
+        }
+        for (unsigned i = 0; i != threads; ++i) {
+            workers.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    ~work_pool() {
+        {
+            std::lock_guard lock{ state };
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    work_pool(const work_pool&) = delete;
+    work_pool& operator=(const work_pool&) = delete;
+
+    std::size_t size() const { return queues.size(); }
+
+    // Tasks submitted from one of this pool's workers go on that worker's own
+    // queue, others are dealt out in turn
+    void submit(std::function<void()> task) {
+        auto i = (current_pool == this) ? current_worker : next++ % queues.size();
+        {
+            std::lock_guard lock{ queues[i]->guard };
+            queues[i]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard lock{ state };
+            ++queued;
+            ++pending;
+        }
+        wake.notify_one();
+    }
+
+    // Blocks until every submitted task has finished, rethrowing the first
+    // exception thrown by any of them
+    void wait() {
+        std::unique_lock lock{ state };
+        done.wait(lock, [this] { return pending == 0; });
+        if (failure) {
+            std::rethrow_exception(std::exchange(failure, nullptr));
+        }
+    }
+
+private:
+    struct task_queue {
+        std::mutex guard;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    // Own queue is used LIFO for locality, victims are robbed FIFO
+    bool take(std::size_t self, std::function<void()>& task) {
+        for (std::size_t k = 0; k != queues.size(); ++k) {
+            auto& q = *queues[(self + k) % queues.size()];
+            std::lock_guard lock{ q.guard };
+            if (!q.tasks.empty()) {
+                if (k == 0) {
+                    task = std::move(q.tasks.back());
+                    q.tasks.pop_back();
+                }
+                else {
+                    task = std::move(q.tasks.front());
+                    q.tasks.pop_front();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::size_t self) {
+        current_pool = this;
+        current_worker = self;
+        for (;;) {
+            {
+                std::unique_lock lock{ state };
+                wake.wait(lock, [this] { return stopping || (queued != 0); });
+                if (queued == 0) {
+                    return;
+                }
+                --queued;
+            }
+            std::function<void()> task;
+            while (!take(self, task)) {
+                std::this_thread::yield();
+            }
+            try {
+                task();
+            }
+            catch (...) {
+                std::lock_guard lock{ state };
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+            std::lock_guard lock{ state };
+            if (--pending == 0) {
+                done.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<std::size_t> next{};
+    std::mutex state;
+    std::condition_variable wake, done;
+    std::size_t queued{}, pending{};
+    bool stopping{};
+    std::exception_ptr failure;
+
+    inline static thread_local work_pool *current_pool{};
+    inline static thread_local std::size_t current_worker{};
+};